@@ -5,6 +5,10 @@ namespace NCL {
 	class AABBVolume : CollisionVolume
 	{
 	public:
+		//Taken from the pooled ones in CollisionVolume, which the private inheritance would hide
+		using CollisionVolume::operator new;
+		using CollisionVolume::operator delete;
+
 		AABBVolume(const Vector3& halfDims) {
 			type		= VolumeType::AABB;
 			halfSizes	= halfDims;
@@ -0,0 +1,63 @@
+#include "BlockPool.h"
+#include <new>
+
+using namespace NCL;
+using namespace CSC8503;
+
+BlockPool::BlockPool(size_t size, int chunkBlocks) {
+	//Every block has to be able to hold a free list link, and stay aligned for anything
+	const size_t alignment = alignof(std::max_align_t);
+
+	size			= size < sizeof(FreeBlock) ? sizeof(FreeBlock) : size;
+	blockSize		= (size + alignment - 1) / alignment * alignment;
+	blocksPerChunk	= chunkBlocks < 1 ? 1 : chunkBlocks;
+	freeList		= nullptr;
+	liveCount		= 0;
+}
+
+BlockPool::~BlockPool() {
+	for (char* c : chunks) {
+		::operator delete(c);
+	}
+}
+
+void BlockPool::AddChunk() {
+	char* chunk = (char*)::operator new(blockSize * blocksPerChunk);
+	chunks.emplace_back(chunk);
+
+	//Pushed on back to front, so they come off the free list in address order
+	for (int i = blocksPerChunk - 1; i >= 0; --i) {
+		FreeBlock* b = (FreeBlock*)(chunk + i * blockSize);
+		b->next	 = freeList;
+		freeList = b;
+	}
+}
+
+void* BlockPool::Allocate(size_t size) {
+	if (size > blockSize) {
+		return ::operator new(size);
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!freeList) {
+		AddChunk();
+	}
+	FreeBlock* b = freeList;
+	freeList = b->next;
+	liveCount++;
+	return b;
+}
+
+void BlockPool::Free(void* block, size_t size) {
+	if (!block) {
+		return;
+	}
+	if (size > blockSize) {
+		::operator delete(block);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	FreeBlock* b = (FreeBlock*)block;
+	b->next	 = freeList;
+	freeList = b;
+	liveCount--;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Hands out fixed size blocks, carved out of chunks that each hold a few
+		hundred of them. Freed blocks go onto a free list and are reused before
+		any new chunk is made, and chunks are never given back, so once a level
+		has been loaded, clearing it and loading another costs no trips to the
+		heap at all. Blocks from a fresh chunk are handed out in address order,
+		so objects made one after another sit next to each other in memory.
+
+		Classes use a pool by deriving from PooledAllocation, below. Requests
+		bigger than the block size (such as from a larger derived class) are
+		passed on to the global operator new.
+		*/
+		class BlockPool	{
+		public:
+			BlockPool(size_t blockSize, int blocksPerChunk = 256);
+			~BlockPool();
+
+			void*	Allocate(size_t size);
+			void	Free(void* block, size_t size);
+
+			size_t GetBlockSize() const {
+				return blockSize;
+			}
+
+			//How many blocks are currently handed out
+			int GetLiveCount() const {
+				return liveCount;
+			}
+
+			int GetCapacity() const {
+				return (int)chunks.size() * blocksPerChunk;
+			}
+
+		protected:
+			struct FreeBlock {
+				FreeBlock* next;
+			};
+
+			void AddChunk();
+
+			size_t				blockSize;
+			int					blocksPerChunk;
+			std::vector<char*>	chunks;
+			FreeBlock*			freeList;
+			int					liveCount;
+			std::mutex			mutex;
+		};
+
+		/*
+		Gives T an operator new / delete that make it from a pool of its own,
+		so every T sits together in memory. Use as class T : public
+		PooledAllocation<T>.
+		*/
+		template <class T>
+		class PooledAllocation {
+		public:
+			static void* operator new(size_t size) {
+				return GetPool().Allocate(size);
+			}
+
+			static void operator delete(void* block, size_t size) {
+				GetPool().Free(block, size);
+			}
+
+		private:
+			//Never destroyed, so anything deleted during shutdown still has a pool to go back to
+			static BlockPool& GetPool() {
+				static BlockPool* pool = new BlockPool(sizeof(T));
+				return *pool;
+			}
+		};
+	}
+}
@@ -10,8 +10,10 @@
 #include <list>
 
 #include "../CSC8503Common/Simplex.h"
+#include "GJKAlgorithm.h"
 
 #include "Debug.h"
+#include "PhysicsSimd.h"
 
 using namespace NCL;
 
@@ -20,6 +22,17 @@ bool CollisionDetection::RayPlaneIntersection(const Ray&r, const Plane&p, RayCol
 	return false;
 }
 
+static bool RayVolumeIntersection(const Ray& r, const Transform& transform, const CollisionVolume& volume, RayCollision& collision) {
+	switch (volume.type) {
+	case VolumeType::AABB: return CollisionDetection::RayAABBIntersection(r, transform, (const AABBVolume&)volume, collision);
+	case VolumeType::OBB: return CollisionDetection::RayOBBIntersection(r,transform, (const OBBVolume&)volume, collision);
+	case VolumeType::Sphere: return CollisionDetection::RaySphereIntersection(r,transform, (const SphereVolume&)volume, collision);
+	case VolumeType::Mesh: return CollisionDetection::RayMeshIntersection(r, transform, (const TriangleMeshVolume&)volume, collision);
+	case VolumeType::Compound: return CollisionDetection::RayCompoundIntersection(r, transform, (const CompoundVolume&)volume, collision);
+	default: return false;
+	}
+}
+
 //获取传入的类型体积，然后调用适当的射线相交函数以查看传入的射线是否与之碰撞
 bool CollisionDetection::RayIntersection(const Ray& r,GameObject& object, RayCollision& collision) {
 	const Transform& transform = object.GetConstTransform();
@@ -27,12 +40,7 @@ bool CollisionDetection::RayIntersection(const Ray& r,GameObject& object, RayCol
 	if (!volume) {
 		return false;
 	}
-	switch (volume->type) {
-	case VolumeType::AABB: return RayAABBIntersection(r, transform, (const AABBVolume&)*volume, collision);
-	case VolumeType::OBB: return RayOBBIntersection(r,transform, (const OBBVolume&)*volume, collision);
-	case VolumeType::Sphere: return RaySphereIntersection(r,transform, (const SphereVolume&)*volume, collision);
-	}
-	return false;
+	return RayVolumeIntersection(r, transform, *volume, collision);
 }
 
 //光线与盒子(AABB/OBB)的碰撞检测
@@ -120,6 +128,10 @@ bool CollisionDetection::RaySphereIntersection(const Ray&r, const Transform& wor
 	Vector3 dir = (spherePos - r.GetPosition());
 	// Then project the sphere 's origin onto our ray direction vector
 	float sphereProj = Vector3::Dot(dir, r.GetDirection());
+	//A sphere wholly behind the ray can't be hit by it
+	if (sphereProj < 0.0f && dir.LengthSquared() > sphereRadius * sphereRadius) {
+		return false;
+	}
 	// Get closest point on ray line to sphere
 	Vector3 point = r.GetPosition() + (r.GetDirection() * sphereProj);
 
@@ -138,42 +150,497 @@ bool CollisionDetection::RaySphereIntersection(const Ray&r, const Transform& wor
 	return true;
 }
 
-bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo) {
-	const CollisionVolume* volA = a->GetBoundingVolume(); //获取碰撞体积的指针来开始该方法的对象
+//Ray / Mesh碰撞
+bool CollisionDetection::RayMeshIntersection(const Ray&r, const Transform& worldTransform, const TriangleMeshVolume& volume, RayCollision& collision) {
+	Matrix3 invTransform = Matrix3(worldTransform.GetWorldOrientation()).Transposed();
+	Vector3 localRayPos = invTransform * (r.GetPosition() - worldTransform.GetWorldPosition());
+
+	float	distance;
+	Vector3 normal;
+	if (!volume.RayCast(localRayPos, invTransform * r.GetDirection(), FLT_MAX, distance, normal)) {
+		return false;
+	}
+	collision.collidedAt	= r.GetPosition() + (r.GetDirection() * distance);
+	collision.rayDistance	= distance;
+	return true;
+}
+
+//Ray / Compound碰撞
+bool CollisionDetection::RayCompoundIntersection(const Ray&r, const Transform& worldTransform, const CompoundVolume& volume, RayCollision& collision) {
+	Transform	childTransform;
+	bool		hit = false;
+	for (int i = 0; i < volume.GetChildCount(); ++i) {
+		volume.GetChildTransform(i, worldTransform, childTransform);
+
+		RayCollision childCollision;
+		if (RayVolumeIntersection(r, childTransform, volume.GetChild(i), childCollision) &&
+			(!hit || childCollision.rayDistance < collision.rayDistance)) {
+			collision.collidedAt	= childCollision.collidedAt;
+			collision.rayDistance	= childCollision.rayDistance;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+static bool AABBKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3*) {
+	return CollisionDetection::AABBIntersection((const AABBVolume&)volumeA, worldTransformA, (const AABBVolume&)volumeB, worldTransformB, collisionInfo);
+}
+
+static bool SphereKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3*) {
+	return CollisionDetection::SphereIntersection((const SphereVolume&)volumeA, worldTransformA, (const SphereVolume&)volumeB, worldTransformB, collisionInfo);
+}
+
+static bool AABBSphereKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3*) {
+	return CollisionDetection::AABBSphereIntersection((const AABBVolume&)volumeA, worldTransformA, (const SphereVolume&)volumeB, worldTransformB, collisionInfo);
+}
+
+static bool GJKKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3* separatingAxis) {
+	return GJKAlgorithm::Intersection(volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo, separatingAxis);
+}
+
+static bool MeshSphereKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3*) {
+	return CollisionDetection::MeshSphereIntersection((const TriangleMeshVolume&)volumeA, worldTransformA, (const SphereVolume&)volumeB, worldTransformB, collisionInfo);
+}
+
+static bool MeshConvexKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3*) {
+	return CollisionDetection::MeshConvexIntersection((const TriangleMeshVolume&)volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo);
+}
+
+static bool CompoundKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3*) {
+	return CollisionDetection::CompoundIntersection((const CompoundVolume&)volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo);
+}
+
+//Runs a kernel with its volumes swapped, then turns its contacts back round to be from A's side
+template<CollisionDetection::IntersectionFunc kernel>
+static bool FlippedKernel(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo, Vector3* separatingAxis) {
+	CollisionDetection::CollisionInfo flipped;
+	Vector3 axis = separatingAxis ? -*separatingAxis : Vector3();
+
+	bool hit = kernel(volumeB, worldTransformB, volumeA, worldTransformA, flipped, separatingAxis ? &axis : nullptr);
+
+	if (separatingAxis) {
+		*separatingAxis = -axis;
+	}
+	for (int i = 0; i < flipped.pointCount; ++i) {
+		const CollisionDetection::ContactPoint& p = flipped.points[i];
+		collisionInfo.AddContactPoint(p.localB, p.localA, -p.normal, p.penetration);
+	}
+	return hit;
+}
+
+//Meshes don't move, so there's no need for them to collide with each other
+static const CollisionDetection::IntersectionFunc intersectionTable[CollisionDetection::VOLUME_TYPE_COUNT][CollisionDetection::VOLUME_TYPE_COUNT] = {
+	//AABB								OBB					Sphere								Mesh								Compound
+	{ AABBKernel,						GJKKernel,			AABBSphereKernel,					FlippedKernel<MeshConvexKernel>,	FlippedKernel<CompoundKernel> },	//AABB
+	{ GJKKernel,						GJKKernel,			GJKKernel,							FlippedKernel<MeshConvexKernel>,	FlippedKernel<CompoundKernel> },	//OBB
+	{ FlippedKernel<AABBSphereKernel>,	GJKKernel,			SphereKernel,						FlippedKernel<MeshSphereKernel>,	FlippedKernel<CompoundKernel> },	//Sphere
+	{ MeshConvexKernel,					MeshConvexKernel,	MeshSphereKernel,					nullptr,							FlippedKernel<CompoundKernel> },	//Mesh
+	{ CompoundKernel,					CompoundKernel,		CompoundKernel,						CompoundKernel,						CompoundKernel },					//Compound
+};
+
+static int VolumeTypeIndex(VolumeType type) {
+	switch (type) {
+		case VolumeType::AABB:		return 0;
+		case VolumeType::OBB:		return 1;
+		case VolumeType::Sphere:	return 2;
+		case VolumeType::Mesh:		return 3;
+		case VolumeType::Compound:	return 4;
+		default:					return -1;
+	}
+}
+
+//Any two volumes, whatever they're attached to
+static bool VolumeIntersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo) {
+	int indexA = VolumeTypeIndex(volumeA.type);
+	int indexB = VolumeTypeIndex(volumeB.type);
+	if (indexA < 0 || indexB < 0 || !intersectionTable[indexA][indexB]) {
+		return false;
+	}
+	return intersectionTable[indexA][indexB](volumeA, worldTransformA, volumeB, worldTransformB, collisionInfo, nullptr);
+}
+
+int CollisionDetection::GetPairType(const GameObject* a, const GameObject* b) {
+	const CollisionVolume* volA = a->GetBoundingVolume();
 	const CollisionVolume* volB = b->GetBoundingVolume();
 	if (!volA || !volB) {
-		return false; //一个形状没有体积
+		return -1;
+	}
+	int indexA = VolumeTypeIndex(volA->type);
+	int indexB = VolumeTypeIndex(volB->type);
+	if (indexA < 0 || indexB < 0 || !intersectionTable[indexA][indexB]) {
+		return -1;
+	}
+	return indexA * VOLUME_TYPE_COUNT + indexB;
+}
+
+bool CollisionDetection::ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo, Vector3* separatingAxis) {
+	int pairType = GetPairType(a, b);
+	if (pairType < 0) {
+		return false;
 	}
-	//获取对象的转换
 	collisionInfo.a = a;
 	collisionInfo.b = b;
-	
-	const Transform& transformA = a->GetConstTransform();
-	const Transform& transformB = b->GetConstTransform();
 
-	VolumeType pairType = (VolumeType)((int)volA->type | (int)volB->type); //按位或之后类型仍然完全相等得到AABB（值1）或Sphere（值2）
+	IntersectionFunc kernel = intersectionTable[pairType / VOLUME_TYPE_COUNT][pairType % VOLUME_TYPE_COUNT];
+	return kernel(*a->GetBoundingVolume(), a->GetConstTransform(), *b->GetBoundingVolume(), b->GetConstTransform(), collisionInfo, separatingAxis);
+}
+
+#if PHYSICS_SIMD_WIDTH > 1
+static const int batchSize = 64;
+
+/*
+A block of candidate pairs, gathered out into one array per component so the
+kernels can load a lane per pair. Spheres keep their radius in sizeX. Blocks
+are padded out to a whole number of lanes with pairs at the origin that have
+no size, which none of the kernels will ever count as touching.
+*/
+struct PairBlock {
+	float ax[batchSize];
+	float ay[batchSize];
+	float az[batchSize];
+	float bx[batchSize];
+	float by[batchSize];
+	float bz[batchSize];
+
+	float sizeAX[batchSize];
+	float sizeAY[batchSize];
+	float sizeAZ[batchSize];
+	float sizeBX[batchSize];
+	float sizeBY[batchSize];
+	float sizeBZ[batchSize];
+};
+
+//What the kernels found for each lane in a block
+struct ContactBlock {
+	float normalX[batchSize];
+	float normalY[batchSize];
+	float normalZ[batchSize];
+	float penetrations[batchSize];
+
+	//AABB pairs keep the box the two overlap in, the rest the sphere's surface point
+	float minX[batchSize];
+	float minY[batchSize];
+	float minZ[batchSize];
+	float maxX[batchSize];
+	float maxY[batchSize];
+	float maxZ[batchSize];
+
+	int hits[batchSize / PHYSICS_SIMD_WIDTH];
+};
+
+static void GatherVolume(const GameObject* object, float& x, float& y, float& z) {
+	const CollisionVolume* volume = object->GetBoundingVolume();
+	if (volume->type == VolumeType::Sphere) {
+		x = ((const SphereVolume*)volume)->GetRadius();
+		y = 0.0f;
+		z = 0.0f;
+		return;
+	}
+	Vector3 halfSize = ((const AABBVolume*)volume)->GetHalfDimensions();
+	x = halfSize.x;
+	y = halfSize.y;
+	z = halfSize.z;
+}
 
-	//返回AABB交集或Sphere交集的结果
-	if (pairType == VolumeType::AABB) { 
-		return AABBIntersection((AABBVolume&)*volA, transformA,(AABBVolume&)*volB, transformB, collisionInfo);
+//Swapped pairs have their objects gathered the other way round, so a box is always A
+static int GatherPairs(const CollisionDetection::CollisionInfo* candidates, int count, bool swapped, PairBlock& block) {
+	for (int i = 0; i < count; ++i) {
+		const GameObject* a = swapped ? candidates[i].b : candidates[i].a;
+		const GameObject* b = swapped ? candidates[i].a : candidates[i].b;
+
+		Vector3 posA = a->GetConstTransform().GetWorldPosition();
+		Vector3 posB = b->GetConstTransform().GetWorldPosition();
+		block.ax[i] = posA.x;
+		block.ay[i] = posA.y;
+		block.az[i] = posA.z;
+		block.bx[i] = posB.x;
+		block.by[i] = posB.y;
+		block.bz[i] = posB.z;
+
+		GatherVolume(a, block.sizeAX[i], block.sizeAY[i], block.sizeAZ[i]);
+		GatherVolume(b, block.sizeBX[i], block.sizeBY[i], block.sizeBZ[i]);
 	}
-	if (pairType == VolumeType::Sphere) {
-		return SphereIntersection((SphereVolume&)*volA, transformA,(SphereVolume&)*volB, transformB, collisionInfo);
+	int padded = (count + PHYSICS_SIMD_WIDTH - 1) / PHYSICS_SIMD_WIDTH * PHYSICS_SIMD_WIDTH;
+	for (int i = count; i < padded; ++i) {
+		block.ax[i] = block.ay[i] = block.az[i] = 0.0f;
+		block.bx[i] = block.by[i] = block.bz[i] = 0.0f;
+		block.sizeAX[i] = block.sizeAY[i] = block.sizeAZ[i] = 0.0f;
+		block.sizeBX[i] = block.sizeBY[i] = block.sizeBZ[i] = 0.0f;
 	}
+	return padded;
+}
 
-	//测试的对象不是同一类型
-	if (volA->type == VolumeType::AABB && volB->type == VolumeType::Sphere) {
-		return AABBSphereIntersection((AABBVolume&)*volA, transformA,(SphereVolume&)*volB, transformB, collisionInfo);
-	
+//The same sums as SphereIntersection, a lane per pair
+static void SphereKernelBlock(const PairBlock& block, int count, ContactBlock& out) {
+	SimdFloat zero	= SimdSet(0.0f);
+	SimdFloat one	= SimdSet(1.0f);
+
+	for (int i = 0; i < count; i += PHYSICS_SIMD_WIDTH) {
+		SimdFloat dx = SimdSub(SimdLoad(block.bx + i), SimdLoad(block.ax + i));
+		SimdFloat dy = SimdSub(SimdLoad(block.by + i), SimdLoad(block.ay + i));
+		SimdFloat dz = SimdSub(SimdLoad(block.bz + i), SimdLoad(block.az + i));
+
+		SimdFloat radiusA	= SimdLoad(block.sizeAX + i);
+		SimdFloat radiusB	= SimdLoad(block.sizeBX + i);
+		SimdFloat radii		= SimdAdd(radiusA, radiusB);
+
+		SimdFloat length	= SimdSqrt(SimdAdd(SimdAdd(SimdMul(dx, dx), SimdMul(dy, dy)), SimdMul(dz, dz)));
+		SimdFloat inverse	= SimdAnd(SimdGreater(length, zero), SimdDiv(one, length));
+
+		SimdFloat nx = SimdMul(dx, inverse);
+		SimdFloat ny = SimdMul(dy, inverse);
+		SimdFloat nz = SimdMul(dz, inverse);
+
+		SimdStore(out.normalX + i, nx);
+		SimdStore(out.normalY + i, ny);
+		SimdStore(out.normalZ + i, nz);
+		SimdStore(out.penetrations + i, SimdSub(radii, length));
+
+		out.hits[i / PHYSICS_SIMD_WIDTH] = SimdMask(SimdLess(length, radii));
 	}
-	if (volA->type == VolumeType::Sphere && volB->type == VolumeType::AABB) {
-		collisionInfo.a = b;
-		collisionInfo.b = a;
-		return AABBSphereIntersection((AABBVolume&)*volB, transformB,(SphereVolume&)*volA, transformA, collisionInfo);
-		
+}
+
+//The same sums as AABBSphereIntersection, with A the box and B the sphere
+static void AABBSphereKernelBlock(const PairBlock& block, int count, ContactBlock& out) {
+	SimdFloat zero	= SimdSet(0.0f);
+	SimdFloat one	= SimdSet(1.0f);
+
+	for (int i = 0; i < count; i += PHYSICS_SIMD_WIDTH) {
+		SimdFloat dx = SimdSub(SimdLoad(block.bx + i), SimdLoad(block.ax + i));
+		SimdFloat dy = SimdSub(SimdLoad(block.by + i), SimdLoad(block.ay + i));
+		SimdFloat dz = SimdSub(SimdLoad(block.bz + i), SimdLoad(block.az + i));
+
+		SimdFloat hx = SimdLoad(block.sizeAX + i);
+		SimdFloat hy = SimdLoad(block.sizeAY + i);
+		SimdFloat hz = SimdLoad(block.sizeAZ + i);
+
+		SimdFloat lx = SimdSub(dx, SimdMin(SimdMax(dx, SimdSub(zero, hx)), hx));
+		SimdFloat ly = SimdSub(dy, SimdMin(SimdMax(dy, SimdSub(zero, hy)), hy));
+		SimdFloat lz = SimdSub(dz, SimdMin(SimdMax(dz, SimdSub(zero, hz)), hz));
+
+		SimdFloat radius	= SimdLoad(block.sizeBX + i);
+		SimdFloat distance	= SimdSqrt(SimdAdd(SimdAdd(SimdMul(lx, lx), SimdMul(ly, ly)), SimdMul(lz, lz)));
+		SimdFloat inverse	= SimdAnd(SimdGreater(distance, zero), SimdDiv(one, distance));
+
+		SimdStore(out.normalX + i, SimdMul(lx, inverse));
+		SimdStore(out.normalY + i, SimdMul(ly, inverse));
+		SimdStore(out.normalZ + i, SimdMul(lz, inverse));
+		SimdStore(out.penetrations + i, SimdSub(radius, distance));
+
+		out.hits[i / PHYSICS_SIMD_WIDTH] = SimdMask(SimdLess(distance, radius));
 	}
-	return false;
+}
+
+/*
+The same sums as AABBIntersection: the overlap test, which of the six faces
+the boxes are least far through, and the box they overlap in. Building the
+corners of the manifold from that is left to the caller.
+*/
+static void AABBKernelBlock(const PairBlock& block, int count, ContactBlock& out) {
+	for (int i = 0; i < count; i += PHYSICS_SIMD_WIDTH) {
+		SimdFloat ax = SimdLoad(block.ax + i);
+		SimdFloat ay = SimdLoad(block.ay + i);
+		SimdFloat az = SimdLoad(block.az + i);
+		SimdFloat bx = SimdLoad(block.bx + i);
+		SimdFloat by = SimdLoad(block.by + i);
+		SimdFloat bz = SimdLoad(block.bz + i);
+
+		SimdFloat hax = SimdLoad(block.sizeAX + i);
+		SimdFloat hay = SimdLoad(block.sizeAY + i);
+		SimdFloat haz = SimdLoad(block.sizeAZ + i);
+		SimdFloat hbx = SimdLoad(block.sizeBX + i);
+		SimdFloat hby = SimdLoad(block.sizeBY + i);
+		SimdFloat hbz = SimdLoad(block.sizeBZ + i);
+
+		SimdFloat overlap = SimdAnd(SimdAnd(
+			SimdLess(SimdAbs(SimdSub(bx, ax)), SimdAdd(hax, hbx)),
+			SimdLess(SimdAbs(SimdSub(by, ay)), SimdAdd(hay, hby))),
+			SimdLess(SimdAbs(SimdSub(bz, az)), SimdAdd(haz, hbz)));
+
+		SimdFloat maxAX = SimdAdd(ax, hax);
+		SimdFloat maxAY = SimdAdd(ay, hay);
+		SimdFloat maxAZ = SimdAdd(az, haz);
+		SimdFloat minAX = SimdSub(ax, hax);
+		SimdFloat minAY = SimdSub(ay, hay);
+		SimdFloat minAZ = SimdSub(az, haz);
+		SimdFloat maxBX = SimdAdd(bx, hbx);
+		SimdFloat maxBY = SimdAdd(by, hby);
+		SimdFloat maxBZ = SimdAdd(bz, hbz);
+		SimdFloat minBX = SimdSub(bx, hbx);
+		SimdFloat minBY = SimdSub(by, hby);
+		SimdFloat minBZ = SimdSub(bz, hbz);
+
+		SimdFloat distances[6] = {
+			SimdSub(maxBX, minAX), SimdSub(maxAX, minBX),
+			SimdSub(maxBY, minAY), SimdSub(maxAY, minBY),
+			SimdSub(maxBZ, minAZ), SimdSub(maxAZ, minBZ)
+		};
+
+		//Faces are kept as floats, so they can be picked between like everything else
+		SimdFloat penetration	= SimdSet(FLT_MAX);
+		SimdFloat face			= SimdSet(0.0f);
+		for (int j = 0; j < 6; ++j) {
+			SimdFloat closer = SimdLess(distances[j], penetration);
+			penetration	= SimdSelect(closer, distances[j], penetration);
+			face		= SimdSelect(closer, SimdSet((float)j), face);
+		}
+		SimdStore(out.penetrations + i, penetration);
+		SimdStore(out.normalX + i, face);
+
+		SimdStore(out.minX + i, SimdMax(minAX, minBX));
+		SimdStore(out.minY + i, SimdMax(minAY, minBY));
+		SimdStore(out.minZ + i, SimdMax(minAZ, minBZ));
+		SimdStore(out.maxX + i, SimdMin(maxAX, maxBX));
+		SimdStore(out.maxY + i, SimdMin(maxAY, maxBY));
+		SimdStore(out.maxZ + i, SimdMin(maxAZ, maxBZ));
+
+		out.hits[i / PHYSICS_SIMD_WIDTH] = SimdMask(overlap);
+	}
+}
+
+static bool LaneHit(const ContactBlock& out, int lane) {
+	return (out.hits[lane / PHYSICS_SIMD_WIDTH] >> (lane % PHYSICS_SIMD_WIDTH)) & 1;
+}
+
+static void SphereBatch(const CollisionDetection::CollisionInfo* candidates, int count, std::vector<CollisionDetection::CollisionInfo>& collisions) {
+	PairBlock		block;
+	ContactBlock	out;
+
+	for (int start = 0; start < count; start += batchSize) {
+		int n		= count - start < batchSize ? count - start : batchSize;
+		int padded	= GatherPairs(candidates + start, n, false, block);
+		SphereKernelBlock(block, padded, out);
+
+		for (int i = 0; i < n; ++i) {
+			if (!LaneHit(out, i)) {
+				continue;
+			}
+			CollisionDetection::CollisionInfo info = candidates[start + i];
+			Vector3 normal(out.normalX[i], out.normalY[i], out.normalZ[i]);
+			info.AddContactPoint(normal * block.sizeAX[i], -normal * block.sizeBX[i], normal, out.penetrations[i]);
+			collisions.emplace_back(info);
+		}
+	}
+}
+
+//Pairs with the sphere first are run with the box first, and flipped back just as FlippedKernel does
+static void AABBSphereBatch(const CollisionDetection::CollisionInfo* candidates, int count, bool sphereFirst,
+	std::vector<CollisionDetection::CollisionInfo>& collisions) {
+	PairBlock		block;
+	ContactBlock	out;
+
+	for (int start = 0; start < count; start += batchSize) {
+		int n		= count - start < batchSize ? count - start : batchSize;
+		int padded	= GatherPairs(candidates + start, n, sphereFirst, block);
+		AABBSphereKernelBlock(block, padded, out);
+
+		for (int i = 0; i < n; ++i) {
+			if (!LaneHit(out, i)) {
+				continue;
+			}
+			CollisionDetection::CollisionInfo info = candidates[start + i];
+			Vector3 normal(out.normalX[i], out.normalY[i], out.normalZ[i]);
+			Vector3 onBox;
+			Vector3 onSphere = -normal * block.sizeBX[i];
+			if (sphereFirst) {
+				info.AddContactPoint(onSphere, onBox, -normal, out.penetrations[i]);
+			}
+			else {
+				info.AddContactPoint(onBox, onSphere, normal, out.penetrations[i]);
+			}
+			collisions.emplace_back(info);
+		}
+	}
+}
+
+static void AABBBatch(const CollisionDetection::CollisionInfo* candidates, int count, std::vector<CollisionDetection::CollisionInfo>& collisions) {
+	static const Vector3 faces[6] = {
+		Vector3(-1, 0, 0), Vector3(1, 0, 0),
+		Vector3(0, -1, 0), Vector3(0, 1, 0),
+		Vector3(0, 0, -1), Vector3(0, 0, 1),
+	};
+	PairBlock		block;
+	ContactBlock	out;
+
+	for (int start = 0; start < count; start += batchSize) {
+		int n		= count - start < batchSize ? count - start : batchSize;
+		int padded	= GatherPairs(candidates + start, n, false, block);
+		AABBKernelBlock(block, padded, out);
+
+		for (int i = 0; i < n; ++i) {
+			if (!LaneHit(out, i)) {
+				continue;
+			}
+			CollisionDetection::CollisionInfo info = candidates[start + i];
+
+			Vector3 posA(block.ax[i], block.ay[i], block.az[i]);
+			Vector3 posB(block.bx[i], block.by[i], block.bz[i]);
+			Vector3 halfA(block.sizeAX[i], block.sizeAY[i], block.sizeAZ[i]);
+			Vector3 halfB(block.sizeBX[i], block.sizeBY[i], block.sizeBZ[i]);
+			Vector3 overlapMin(out.minX[i], out.minY[i], out.minZ[i]);
+			Vector3 overlapMax(out.maxX[i], out.maxY[i], out.maxZ[i]);
+
+			int bestFace	= (int)out.normalX[i];
+			int normalAxis	= bestFace / 2;
+			int uAxis		= (normalAxis + 1) % 3;
+			int vAxis		= (normalAxis + 2) % 3;
+
+			float plane = (bestFace & 1) ? ((posA + halfA)[normalAxis] + (posB - halfB)[normalAxis]) * 0.5f
+										 : ((posA - halfA)[normalAxis] + (posB + halfB)[normalAxis]) * 0.5f;
+
+			for (int j = 0; j < 4; ++j) {
+				Vector3 corner;
+				corner[normalAxis]	= plane;
+				corner[uAxis]		= (j & 1) ? overlapMax[uAxis] : overlapMin[uAxis];
+				corner[vAxis]		= (j & 2) ? overlapMax[vAxis] : overlapMin[vAxis];
+
+				info.AddContactPoint(corner - posA, corner - posB, faces[bestFace], out.penetrations[i]);
+			}
+			collisions.emplace_back(info);
+		}
+	}
+}
+#endif
 
+void CollisionDetection::BatchIntersection(int pairType, const CollisionInfo* candidates, Vector3* separatingAxes, int count,
+	std::vector<CollisionInfo>& collisions) {
+#if PHYSICS_SIMD_WIDTH > 1
+	static const int aabbIndex		= VolumeTypeIndex(VolumeType::AABB);
+	static const int sphereIndex	= VolumeTypeIndex(VolumeType::Sphere);
+
+	if (pairType == sphereIndex * VOLUME_TYPE_COUNT + sphereIndex) {
+		SphereBatch(candidates, count, collisions);
+		return;
+	}
+	if (pairType == aabbIndex * VOLUME_TYPE_COUNT + aabbIndex) {
+		AABBBatch(candidates, count, collisions);
+		return;
+	}
+	if (pairType == aabbIndex * VOLUME_TYPE_COUNT + sphereIndex) {
+		AABBSphereBatch(candidates, count, false, collisions);
+		return;
+	}
+	if (pairType == sphereIndex * VOLUME_TYPE_COUNT + aabbIndex) {
+		AABBSphereBatch(candidates, count, true, collisions);
+		return;
+	}
+#endif
+	for (int i = 0; i < count; ++i) {
+		CollisionInfo info = candidates[i];
+		if (ObjectIntersection(info.a, info.b, info, separatingAxes ? &separatingAxes[i] : nullptr)) {
+			collisions.emplace_back(info);
+		}
+	}
 }
 
 //告诉我们是否这些物体正在碰撞
@@ -231,17 +698,40 @@ bool CollisionDetection::AABBIntersection(const AABBVolume& volumeA, const Trans
 
 		float penetration = FLT_MAX;
 		Vector3 axis;
+		int bestFace = 0;
 
 		for (int i = 0; i < 6; i++)
 		{
 			if (distances[i] < penetration) {
 				penetration = distances[i];
 				axis = faces[i];
-
+				bestFace = i;
 			}
 		}
 
-		collisionInfo.AddContactPoint(Vector3(), Vector3(), axis, penetration);
+		//The boxes overlap over a rectangle on the faces that meet - its corners,
+		//halfway between the two faces, make up the contact manifold
+		int normalAxis	= bestFace / 2;
+		int uAxis		= (normalAxis + 1) % 3;
+		int vAxis		= (normalAxis + 2) % 3;
+
+		Vector3 overlapMin;
+		Vector3 overlapMax;
+		for (int i = 0; i < 3; ++i) {
+			overlapMin[i] = minA[i] > minB[i] ? minA[i] : minB[i];
+			overlapMax[i] = maxA[i] < maxB[i] ? maxA[i] : maxB[i];
+		}
+		float plane = (bestFace & 1) ? (maxA[normalAxis] + minB[normalAxis]) * 0.5f
+									 : (minA[normalAxis] + maxB[normalAxis]) * 0.5f;
+
+		for (int i = 0; i < 4; ++i) {
+			Vector3 corner;
+			corner[normalAxis]	= plane;
+			corner[uAxis]		= (i & 1) ? overlapMax[uAxis] : overlapMin[uAxis];
+			corner[vAxis]		= (i & 2) ? overlapMax[vAxis] : overlapMin[vAxis];
+
+			collisionInfo.AddContactPoint(corner - boxAPos, corner - boxBPos, axis, penetration);
+		}
 		return true;
 	}
 		return false;
@@ -300,7 +790,291 @@ bool CollisionDetection::AABBSphereIntersection(const AABBVolume& volumeA, const
 bool CollisionDetection::OBBIntersection(
 	const OBBVolume& volumeA, const Transform& worldTransformA,
 	const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
-	return false;
+	return GJKAlgorithm::Intersection((const CollisionVolume&)volumeA, worldTransformA,
+		(const CollisionVolume&)volumeB, worldTransformB, collisionInfo);
+}
+
+//Ericson's closest point on a triangle, going by which region round it p falls in
+static Vector3 ClosestPointOnTriangle(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c) {
+	Vector3 ab = b - a;
+	Vector3 ac = c - a;
+	Vector3 ap = p - a;
+	float d1 = Vector3::Dot(ab, ap);
+	float d2 = Vector3::Dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		return a;
+	}
+	Vector3 bp = p - b;
+	float d3 = Vector3::Dot(ab, bp);
+	float d4 = Vector3::Dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) {
+		return b;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return a + ab * (d1 / (d1 - d3));
+	}
+	Vector3 cp = p - c;
+	float d5 = Vector3::Dot(ab, cp);
+	float d6 = Vector3::Dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) {
+		return c;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return a + ac * (d2 / (d2 - d6));
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+bool CollisionDetection::MeshSphereIntersection(const TriangleMeshVolume& volumeA, const Transform& worldTransformA,
+	const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	Vector3 meshPos		= worldTransformA.GetWorldPosition();
+	Matrix3 transform		= Matrix3(worldTransformA.GetWorldOrientation());
+	Matrix3 invTransform	= transform.Transposed();
+
+	float	radius	= volumeB.GetRadius();
+	Vector3 centre	= invTransform * (worldTransformB.GetWorldPosition() - meshPos);
+
+	float	closestSq = radius * radius;
+	Vector3 closestPoint;
+	Vector3 faceNormal;
+	bool	hit = false;
+
+	volumeA.Query(BroadphaseBounds(centre, Vector3(radius, radius, radius)), [&](int triangle) {
+		Vector3 a, b, c;
+		volumeA.GetTriangle(triangle, a, b, c);
+		Vector3 point		= ClosestPointOnTriangle(centre, a, b, c);
+		float	distanceSq	= (centre - point).LengthSquared();
+		if (distanceSq < closestSq) {
+			closestSq		= distanceSq;
+			closestPoint	= point;
+			faceNormal		= Vector3::Cross(b - a, c - a);
+			hit = true;
+		}
+		return true;
+	});
+	if (!hit) {
+		return false;
+	}
+	float	distance	= sqrt(closestSq);
+	Vector3 normal		= centre - closestPoint;
+	if (distance > 0.0f) {
+		normal = normal / distance;
+	}
+	else {
+		//Right on the surface, so there's nothing to say which side it's on but the winding
+		normal = faceNormal.Normalised();
+	}
+	Vector3 worldNormal = transform * normal;
+
+	collisionInfo.AddContactPoint(transform * closestPoint, -worldNormal * radius, worldNormal, radius - distance);
+	return true;
+}
+
+bool CollisionDetection::MeshConvexIntersection(const TriangleMeshVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	const int	maxTriangleContacts = 16;
+	const float sameNormal			= 0.95f;
+
+	Vector3 halfSize;
+	if (volumeB.type == VolumeType::AABB) {
+		halfSize = ((const AABBVolume&)volumeB).GetHalfDimensions();
+	}
+	else if (volumeB.type == VolumeType::OBB) {
+		halfSize = Matrix3(worldTransformB.GetWorldOrientation()).Absolute() * ((const OBBVolume&)volumeB).GetHalfDimensions();
+	}
+	else {
+		return false;
+	}
+	Vector3 meshPos		= worldTransformA.GetWorldPosition();
+	Matrix3 transform		= Matrix3(worldTransformA.GetWorldOrientation());
+	Matrix3 invTransform	= transform.Transposed();
+
+	Vector3 localPos		= invTransform * (worldTransformB.GetWorldPosition() - meshPos);
+	Vector3 localHalfSize	= invTransform.Absolute() * halfSize;
+
+	ContactPoint	found[maxTriangleContacts];
+	int				foundCount	= 0;
+	int				deepest		= -1;
+
+	volumeA.Query(BroadphaseBounds(localPos, localHalfSize), [&](int triangle) {
+		Vector3 corners[3];
+		volumeA.GetTriangle(triangle, corners[0], corners[1], corners[2]);
+		for (int i = 0; i < 3; ++i) {
+			corners[i] = meshPos + transform * corners[i];
+		}
+		CollisionInfo triangleInfo;
+		if (GJKAlgorithm::TriangleIntersection(corners, meshPos, volumeB, worldTransformB, triangleInfo)) {
+			found[foundCount] = triangleInfo.points[0];
+			if (deepest < 0 || found[foundCount].penetration > found[deepest].penetration) {
+				deepest = foundCount;
+			}
+			foundCount++;
+		}
+		return foundCount < maxTriangleContacts;
+	});
+	if (deepest < 0) {
+		return false;
+	}
+	Vector3 normal = found[deepest].normal;
+	collisionInfo.AddContactPoint(found[deepest].localA, found[deepest].localB, normal, found[deepest].penetration);
+	for (int i = 0; i < foundCount; ++i) {
+		if (i != deepest && Vector3::Dot(found[i].normal, normal) > sameNormal) {
+			collisionInfo.AddContactPoint(found[i].localA, found[i].localB, normal, found[i].penetration);
+		}
+	}
+	return true;
+}
+
+bool CollisionDetection::CompoundIntersection(const CompoundVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo) {
+	Vector3		centre = worldTransformA.GetWorldPosition();
+	Transform	childTransform;
+
+	CollisionInfo	best;
+	float			bestDepth	= 0.0f;
+	Vector3			bestOffset;
+
+	for (int i = 0; i < volumeA.GetChildCount(); ++i) {
+		volumeA.GetChildTransform(i, worldTransformA, childTransform);
+
+		CollisionInfo childInfo;
+		if (!VolumeIntersection(volumeA.GetChild(i), childTransform, volumeB, worldTransformB, childInfo)) {
+			continue;
+		}
+		float depth = 0.0f;
+		for (int j = 0; j < childInfo.pointCount; ++j) {
+			depth = childInfo.points[j].penetration > depth ? childInfo.points[j].penetration : depth;
+		}
+		if (best.pointCount == 0 || depth > bestDepth) {
+			best		= childInfo;
+			bestDepth	= depth;
+			bestOffset	= childTransform.GetWorldPosition() - centre;
+		}
+	}
+	//The child's points are from its own centre, rather than the whole object's
+	for (int i = 0; i < best.pointCount; ++i) {
+		const ContactPoint& p = best.points[i];
+		collisionInfo.AddContactPoint(p.localA + bestOffset, p.localB, p.normal, p.penetration);
+	}
+	return best.pointCount > 0;
+}
+
+//A segment from start along path, against a box grown out by the moving volume's size
+static bool SweptBoxTest(const Vector3& start, const Vector3& path, const Vector3& boxPos, const Vector3& halfSize, float& timeOfImpact) {
+	float enter = -FLT_MAX;
+	float exit	= FLT_MAX;
+
+	for (int i = 0; i < 3; ++i) {
+		float minPlane = boxPos[i] - halfSize[i];
+		float maxPlane = boxPos[i] + halfSize[i];
+
+		if (path[i] == 0.0f) {
+			if (start[i] < minPlane || start[i] > maxPlane) {
+				return false; //running alongside this slab, never getting into it
+			}
+			continue;
+		}
+		float t1 = (minPlane - start[i]) / path[i];
+		float t2 = (maxPlane - start[i]) / path[i];
+		if (t1 > t2) {
+			float temp = t1; t1 = t2; t2 = temp;
+		}
+		enter	= t1 > enter ? t1 : enter;
+		exit	= t2 < exit ? t2 : exit;
+	}
+	if (enter > exit || enter <= 0.0f || enter > 1.0f) {
+		return false;
+	}
+	timeOfImpact = enter;
+	return true;
+}
+
+static bool SweptSphereTest(const Vector3& start, const Vector3& path, const Vector3& spherePos, float radius, float& timeOfImpact) {
+	Vector3 m = start - spherePos;
+	float c = Vector3::Dot(m, m) - radius * radius;
+	if (c <= 0.0f) {
+		return false; //already inside
+	}
+	float a = Vector3::Dot(path, path);
+	float b = Vector3::Dot(m, path);
+	if (b >= 0.0f || a == 0.0f) {
+		return false; //moving away, or not moving at all
+	}
+	float discriminant = b * b - a * c;
+	if (discriminant < 0.0f) {
+		return false;
+	}
+	float t = (-b - sqrtf(discriminant)) / a;
+	if (t > 1.0f) {
+		return false;
+	}
+	timeOfImpact = t;
+	return true;
+}
+
+static Vector3 VolumeHalfSize(const CollisionVolume& volume) {
+	if (volume.type == VolumeType::Sphere) {
+		float r = ((const SphereVolume&)volume).GetRadius();
+		return Vector3(r, r, r);
+	}
+	return ((const AABBVolume&)volume).GetHalfDimensions();
+}
+
+/*
+The centre of the moving volume as a ray against the mesh, stopping short of
+the triangle it hits by the volume's smallest half size. That's only exact
+for a sphere going straight at a triangle, and is late otherwise, but the
+centre never gets through, so the narrowphase can push it back out.
+*/
+static bool SweptMeshTest(const Vector3& halfSize, const Vector3& start, const Vector3& path,
+	const TriangleMeshVolume& mesh, const Transform& meshTransform, float& timeOfImpact) {
+	float pathLength = path.Length();
+	if (pathLength == 0.0f) {
+		return false;
+	}
+	Matrix3 invTransform	= Matrix3(meshTransform.GetWorldOrientation()).Transposed();
+	Vector3 localStart		= invTransform * (start - meshTransform.GetWorldPosition());
+	Vector3 localDirection	= invTransform * (path / pathLength);
+
+	float	distance;
+	Vector3 normal;
+	if (!mesh.RayCast(localStart, localDirection, pathLength, distance, normal)) {
+		return false;
+	}
+	float size = halfSize.x < halfSize.y ? halfSize.x : halfSize.y;
+	size = halfSize.z < size ? halfSize.z : size;
+	if (distance <= size) {
+		return false;
+	}
+	timeOfImpact = (distance - size) / pathLength;
+	return true;
+}
+
+bool CollisionDetection::SweptVolumeTest(const CollisionVolume& volume, const Vector3& start, const Vector3& end,
+	const CollisionVolume& target, const Transform& targetTransform, float& timeOfImpact) {
+	bool knownVolume = volume.type == VolumeType::Sphere || volume.type == VolumeType::AABB;
+	bool knownTarget = target.type == VolumeType::Sphere || target.type == VolumeType::AABB;
+	if (knownVolume && target.type == VolumeType::Mesh) {
+		return SweptMeshTest(VolumeHalfSize(volume), start, end - start, (const TriangleMeshVolume&)target, targetTransform, timeOfImpact);
+	}
+	if (!knownVolume || !knownTarget) {
+		return false;
+	}
+	Vector3 path		= end - start;
+	Vector3 targetPos	= targetTransform.GetWorldPosition();
+
+	if (volume.type == VolumeType::Sphere && target.type == VolumeType::Sphere) {
+		float radii = ((const SphereVolume&)volume).GetRadius() + ((const SphereVolume&)target).GetRadius();
+		return SweptSphereTest(start, path, targetPos, radii, timeOfImpact);
+	}
+	return SweptBoxTest(start, path, targetPos, VolumeHalfSize(volume) + VolumeHalfSize(target), timeOfImpact);
 }
 
 //It's helper functions for generating rays from here on out:
@@ -9,8 +9,12 @@
 #include "AABBVolume.h"
 #include "OBBVolume.h"
 #include "SphereVolume.h"
+#include "TriangleMeshVolume.h"
+#include "CompoundVolume.h"
 #include "Ray.h"
 
+#include <vector>
+
 using NCL::Camera;
 using namespace NCL::Maths;
 using namespace NCL::CSC8503;
@@ -18,25 +22,48 @@ namespace NCL {
 	class CollisionDetection
 	{
 	public:
+		//Offsets are from each object's centre, in world space. The solver
+		//keeps the impulses it applied, to start the next step off with.
 		struct ContactPoint {
 			Vector3 localA;
 			Vector3 localB;
 			Vector3 position;
 			Vector3 normal;
 			float	penetration;
+
+			float	normalImpulse;
+			Vector3 frictionImpulse;
 		};
+
+		static const int MAX_CONTACT_POINTS = 4;
+
 		struct CollisionInfo {
 			GameObject* a;
 			GameObject* b;		
 			mutable int		framesLeft;
 
-			ContactPoint point;
+			//Every point the two objects are touching at, all sharing a normal
+			ContactPoint points[MAX_CONTACT_POINTS];
+			int			 pointCount;
+
+			CollisionInfo() {
+				a			= nullptr;
+				b			= nullptr;
+				framesLeft	= 0;
+				pointCount	= 0;
+			}
 
 			void AddContactPoint(const Vector3& localA,const Vector3&localB,const Vector3& normal, float p) {
+				if (pointCount == MAX_CONTACT_POINTS) {
+					return;
+				}
+				ContactPoint& point = points[pointCount++];
 				point.localA = localA;
 				point.localB = localB;
 				point.normal		= normal;
 				point.penetration	= p;
+				point.normalImpulse		= 0.0f;
+				point.frictionImpulse	= Vector3();
 			}
 
 			//Advanced collision detection / resolution
@@ -65,13 +92,42 @@ namespace NCL {
 		static bool RayAABBIntersection(const Ray&r, const Transform& worldTransform, const AABBVolume&	volume, RayCollision& collision);
 		static bool RayOBBIntersection(const Ray&r, const Transform& worldTransform, const OBBVolume&	volume, RayCollision& collision);
 		static bool RaySphereIntersection(const Ray&r, const Transform& worldTransform, const SphereVolume& volume, RayCollision& collision);
+		static bool RayMeshIntersection(const Ray&r, const Transform& worldTransform, const TriangleMeshVolume& volume, RayCollision& collision);
+		static bool RayCompoundIntersection(const Ray&r, const Transform& worldTransform, const CompoundVolume& volume, RayCollision& collision);
 
 		static bool RayPlaneIntersection(const Ray&r, const Plane&p, RayCollision& collisions);
 
 		static bool	AABBTest(const Vector3& posA, const Vector3& posB, const Vector3& halfSizeA, const Vector3& halfSizeB);
 
 
-		static bool ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo);
+		/*
+		Every pair of volume types has its own intersection kernel, looked up
+		in a table rather than worked out with a chain of ifs. Kernels fill in
+		contact points from A's side, with the normal pointing from A to B, so
+		a pair that only has a kernel the other way round is run swapped, and
+		its contacts flipped back.
+		*/
+		typedef bool (*IntersectionFunc)(const CollisionVolume& volumeA, const Transform& worldTransformA,
+			const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo, Vector3* separatingAxis);
+
+		static const int VOLUME_TYPE_COUNT	= 5;
+		static const int PAIR_TYPE_COUNT	= VOLUME_TYPE_COUNT * VOLUME_TYPE_COUNT;
+
+		//-1 if the objects can't collide with each other at all
+		static int GetPairType(const GameObject* a, const GameObject* b);
+
+		//Pairs that go through GJK try the separating axis first, and have it updated with the one they end up with
+		static bool ObjectIntersection(GameObject* a, GameObject* b, CollisionInfo& collisionInfo, Vector3* separatingAxis = nullptr);
+
+		/*
+		Tests a run of candidate pairs that all share the given pair type,
+		adding each one that collides onto the end of collisions. Pairs made
+		of spheres and AABBs are gathered into blocks, and run through SIMD
+		kernels a lane per pair, which do the same sums as the functions
+		below. Everything else goes through ObjectIntersection one at a time.
+		*/
+		static void BatchIntersection(int pairType, const CollisionInfo* candidates, Vector3* separatingAxes, int count,
+			std::vector<CollisionInfo>& collisions);
 
 
 		static bool AABBIntersection(	const AABBVolume& volumeA, const Transform& worldTransformA,
@@ -86,6 +142,34 @@ namespace NCL {
 		static bool OBBIntersection(	const OBBVolume& volumeA, const Transform& worldTransformA,
 										const OBBVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
 
+		//The deepest point of the mesh the sphere is touching
+		static bool MeshSphereIntersection(const TriangleMeshVolume& volumeA, const Transform& worldTransformA,
+										const SphereVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
+
+		/*
+		An AABB or OBB against each triangle it might touch, through GJK. The
+		deepest triangle decides the normal, and the points of any others
+		facing much the same way are added alongside it, so that a box
+		sitting across several triangles of a floor is held up at each.
+		*/
+		static bool MeshConvexIntersection(const TriangleMeshVolume& volumeA, const Transform& worldTransformA,
+										const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
+
+		//Each child against B, keeping the contacts of whichever child is in furthest
+		static bool CompoundIntersection(const CompoundVolume& volumeA, const Transform& worldTransformA,
+										const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionInfo& collisionInfo);
+
+		/*
+		How far along its path a volume moving from start to end first touches
+		a target that stays still, as a fraction between 0 and 1. A target that
+		is already touching at the start gives no hit, as that's a job for the
+		narrowphase. Anything involving a box is treated as a box the whole way
+		round, so hits near corners come a little early, but never late.
+		Meshes are only swept against with the moving volume's centre.
+		*/
+		static bool SweptVolumeTest(const CollisionVolume& volume, const Vector3& start, const Vector3& end,
+									const CollisionVolume& target, const Transform& targetTransform, float& timeOfImpact);
+
 		//Boring helper functions to project screen positions to world positions (used by raycasting!)
 		static Vector3 Unproject(const Vector3& screenPos, const Camera& cam);
 
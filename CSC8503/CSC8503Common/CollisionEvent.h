@@ -0,0 +1,29 @@
+#pragma once
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameObject;
+
+		enum class CollisionEventType {
+			Begin,	//the pair has just started touching
+			Stay,	//the pair was already touching, and still is
+			End,	//the pair has stopped touching
+			Contact	//the pair was found touching, and its layers are set to report contacts
+		};
+
+		/*
+		Something that happened to a pair of objects during a physics step.
+		The physics system gathers these up into a buffer as it goes, rather
+		than calling into gameplay code mid update, and the game then works
+		through them once the update is over.
+		*/
+		struct CollisionEvent {
+			GameObject*			a;
+			GameObject*			b;
+			CollisionEventType	type;
+
+			CollisionEvent(GameObject* a, GameObject* b, CollisionEventType type) : a(a), b(b), type(type) {
+			}
+		};
+	}
+}
@@ -0,0 +1,112 @@
+#include "CollisionPairCache.h"
+#include "GameObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+//Spreads the bits of a pair key out, so that neighbouring IDs don't all land in neighbouring slots
+static size_t HashPairKey(uint64_t key) {
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (size_t)key;
+}
+
+CollisionPairCache::CollisionPairCache()	{
+	slots.assign(64, -1);
+}
+
+CollisionPairCache::~CollisionPairCache()	{
+}
+
+void CollisionPairCache::Clear() {
+	pairs.clear();
+	slots.assign(slots.size(), -1);
+}
+
+/*
+The lower world ID always goes in the top half of the key, so a pair gets
+the same key whichever way round its objects are.
+*/
+uint64_t CollisionPairCache::GetPairKey(const GameObject* a, const GameObject* b) {
+	uint32_t idA = (uint32_t)a->GetWorldID();
+	uint32_t idB = (uint32_t)b->GetWorldID();
+	if (idA > idB) {
+		uint32_t temp = idA;
+		idA = idB;
+		idB = temp;
+	}
+	return ((uint64_t)idA << 32) | (uint64_t)idB;
+}
+
+CollisionPair& CollisionPairCache::Insert(const CollisionDetection::CollisionInfo& info) {
+	//Keep the table at most half full, so probe sequences stay short
+	if ((pairs.size() + 1) * 2 > slots.size()) {
+		Rehash(slots.size() * 2);
+	}
+	uint64_t key	= GetPairKey(info.a, info.b);
+	int slot		= FindSlot(key);
+
+	if (slots[slot] == -1) {
+		slots[slot] = (int)pairs.size();
+		pairs.emplace_back();
+		pairs.back().key		= key;
+		pairs.back().hasBegun	= false;
+	}
+	CollisionPair& pair = pairs[slots[slot]];
+	pair.info = info;
+	return pair;
+}
+
+CollisionPair* CollisionPairCache::Find(const GameObject* a, const GameObject* b) {
+	int slot = FindSlot(GetPairKey(a, b));
+	if (slots[slot] == -1) {
+		return nullptr;
+	}
+	return &pairs[slots[slot]];
+}
+
+/*
+Removing from a linear probed table can't just empty the slot, as that would
+cut short the probe sequence of anything stored after it. Instead, later
+entries that would rather be in the hole are shuffled back to fill it.
+*/
+void CollisionPairCache::RemoveAt(int index) {
+	size_t mask = slots.size() - 1;
+	size_t hole = (size_t)FindSlot(pairs[index].key);
+	size_t next = (hole + 1) & mask;
+
+	while (slots[next] != -1) {
+		size_t home = HashPairKey(pairs[slots[next]].key) & mask;
+		bool canMove = (next > hole) ? (home <= hole || home > next) : (home <= hole && home > next);
+		if (canMove) {
+			slots[hole] = slots[next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+	slots[hole] = -1;
+
+	int last = (int)pairs.size() - 1;
+	if (index != last) {
+		pairs[index] = pairs[last];
+		slots[FindSlot(pairs[index].key)] = index;
+	}
+	pairs.pop_back();
+}
+
+int CollisionPairCache::FindSlot(uint64_t key) const {
+	size_t mask = slots.size() - 1;
+	size_t slot = HashPairKey(key) & mask;
+	while (slots[slot] != -1 && pairs[slots[slot]].key != key) {
+		slot = (slot + 1) & mask;
+	}
+	return (int)slot;
+}
+
+void CollisionPairCache::Rehash(size_t slotCount) {
+	slots.assign(slotCount, -1);
+	for (int i = 0; i < (int)pairs.size(); ++i) {
+		slots[FindSlot(pairs[i].key)] = i;
+	}
+}
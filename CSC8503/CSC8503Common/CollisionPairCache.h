@@ -0,0 +1,63 @@
+#pragma once
+#include "CollisionDetection.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		class GameObject;
+
+		struct CollisionPair {
+			CollisionDetection::CollisionInfo info;
+			uint64_t	key;
+			bool		hasBegun;	//OnCollisionBegin has been sent for this pair
+		};
+
+		/*
+		Keeps track of every pair of objects that are currently in contact.
+		The pairs themselves live in a flat array, so they can be stepped
+		through in order without chasing pointers, with an open addressed hash
+		table of indices into that array used to find a given pair quickly.
+		Pairs are identified by their objects' world IDs, so no two different
+		pairs can ever end up sharing a key.
+		*/
+		class CollisionPairCache	{
+		public:
+			CollisionPairCache();
+			~CollisionPairCache();
+
+			void Clear();
+
+			//Returns the pair's entry, adding a new one if it isn't already cached.
+			//Either way, the entry's collision info is overwritten with this one.
+			CollisionPair& Insert(const CollisionDetection::CollisionInfo& info);
+
+			//Returns nullptr if the pair isn't cached
+			CollisionPair* Find(const GameObject* a, const GameObject* b);
+
+			//The last pair is moved into the removed pair's place
+			void RemoveAt(int index);
+
+			int GetCount() const {
+				return (int)pairs.size();
+			}
+
+			CollisionPair& GetPair(int index) {
+				return pairs[index];
+			}
+
+			int GetPairIndex(const CollisionPair& pair) const {
+				return (int)(&pair - pairs.data());
+			}
+
+			static uint64_t GetPairKey(const GameObject* a, const GameObject* b);
+
+		protected:
+			int		FindSlot(uint64_t key) const;
+			void	Rehash(size_t slotCount);
+
+			std::vector<CollisionPair>	pairs;
+			std::vector<int>			slots;	//index into pairs, or -1 if empty
+		};
+	}
+}
@@ -0,0 +1,30 @@
+#include "CollisionVolume.h"
+#include "BlockPool.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+Volumes come in a handful of sizes, so rather than a pool per kind of
+volume, each is made from the smallest of these that fits it. The last
+pool passes anything bigger than it on to the global operator new.
+*/
+static const int volumePoolCount	= 4;
+static const int volumePoolStep		= 16;
+
+static BlockPool& GetVolumePool(size_t size) {
+	static BlockPool* pools[volumePoolCount] = {
+		new BlockPool(volumePoolStep * 1), new BlockPool(volumePoolStep * 2),
+		new BlockPool(volumePoolStep * 3), new BlockPool(volumePoolStep * 4)
+	};
+	size_t pool = (size - 1) / volumePoolStep;
+	return *pools[pool < volumePoolCount ? pool : volumePoolCount - 1];
+}
+
+void* CollisionVolume::operator new(size_t size) {
+	return GetVolumePool(size).Allocate(size);
+}
+
+void CollisionVolume::operator delete(void* block, size_t size) {
+	GetVolumePool(size).Free(block, size);
+}
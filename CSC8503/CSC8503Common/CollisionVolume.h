@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+
 namespace NCL {
 	enum class VolumeType {
 		AABB	= 1,
@@ -15,7 +17,11 @@ namespace NCL {
 		CollisionVolume() {
 			type = VolumeType::Invalid;
 		}
-		~CollisionVolume() {}
+		virtual ~CollisionVolume() {}
+
+		//Every kind of volume is made from a pool of volumes the same size as it
+		static void* operator new(size_t size);
+		static void operator delete(void* block, size_t size);
 
 		VolumeType type;
 	};
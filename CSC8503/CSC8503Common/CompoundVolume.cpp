@@ -0,0 +1,68 @@
+#include "CompoundVolume.h"
+#include "AABBVolume.h"
+#include "OBBVolume.h"
+#include "SphereVolume.h"
+#include "TriangleMeshVolume.h"
+#include "Transform.h"
+#include "../../Common/Matrix3.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+CompoundVolume::~CompoundVolume() {
+	for (Child& c : children) {
+		delete c.volume;
+	}
+}
+
+void CompoundVolume::AddChild(CollisionVolume* volume, const Vector3& localPosition, const Quaternion& localOrientation) {
+	Child c;
+	c.volume			= volume;
+	c.localPosition		= localPosition;
+	c.localOrientation	= localOrientation;
+	children.emplace_back(c);
+
+	Matrix3 rotation = Matrix3(localOrientation).Absolute();
+	Vector3 reach = rotation * GetVolumeHalfSize(*volume);
+	for (int i = 0; i < 3; ++i) {
+		float extent = fabs(localPosition[i]) + reach[i];
+		localHalfSize[i] = extent > localHalfSize[i] ? extent : localHalfSize[i];
+	}
+}
+
+void CompoundVolume::GetChildTransform(int child, const Transform& worldTransform, Transform& childTransform) const {
+	const Child& c = children[child];
+	Quaternion orientation = worldTransform.GetWorldOrientation();
+
+	childTransform.SetLocalPosition(worldTransform.GetWorldPosition() + orientation * c.localPosition);
+	childTransform.SetLocalOrientation(orientation * c.localOrientation);
+	childTransform.UpdateMatrices();
+}
+
+Vector3 CompoundVolume::GetVolumeHalfSize(const CollisionVolume& volume) {
+	switch (volume.type) {
+		case VolumeType::AABB: {
+			return ((const AABBVolume&)volume).GetHalfDimensions();
+		}
+		case VolumeType::OBB: {
+			return ((const OBBVolume&)volume).GetHalfDimensions();
+		}
+		case VolumeType::Sphere: {
+			float r = ((const SphereVolume&)volume).GetRadius();
+			return Vector3(r, r, r);
+		}
+		case VolumeType::Mesh: {
+			const BroadphaseBounds& bounds = ((const TriangleMeshVolume&)volume).GetLocalBounds();
+			return Vector3(
+				fabs(bounds.min.x) > fabs(bounds.max.x) ? fabs(bounds.min.x) : fabs(bounds.max.x),
+				fabs(bounds.min.y) > fabs(bounds.max.y) ? fabs(bounds.min.y) : fabs(bounds.max.y),
+				fabs(bounds.min.z) > fabs(bounds.max.z) ? fabs(bounds.min.z) : fabs(bounds.max.z));
+		}
+		case VolumeType::Compound: {
+			return ((const CompoundVolume&)volume).GetLocalHalfSize();
+		}
+		default: {
+			return Vector3();
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "CollisionVolume.h"
+#include "../../Common/Vector3.h"
+#include "../../Common/Quaternion.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		class Transform;
+	}
+	using namespace NCL::Maths;
+
+	/*
+	A shape made out of other volumes, each placed somewhere relative to the
+	object it's attached to, for things like the goose that a single box or
+	sphere fits badly. A compound collides with something if any of its
+	children do, and owns its children, deleting them along with itself.
+
+	AABB children stay lined up with the world axes however the object is
+	turned, as they do anywhere else.
+	*/
+	class CompoundVolume : CollisionVolume
+	{
+	public:
+		//Taken from the pooled ones in CollisionVolume, which the private inheritance would hide
+		using CollisionVolume::operator new;
+		using CollisionVolume::operator delete;
+
+		CompoundVolume() {
+			type = VolumeType::Compound;
+		}
+		~CompoundVolume();
+
+		void AddChild(CollisionVolume* volume, const Vector3& localPosition, const Quaternion& localOrientation = Quaternion());
+
+		int GetChildCount() const {
+			return (int)children.size();
+		}
+
+		const CollisionVolume& GetChild(int child) const {
+			return *children[child].volume;
+		}
+
+		//Where a child is in the world, given where the object it's attached to is
+		void GetChildTransform(int child, const CSC8503::Transform& worldTransform, CSC8503::Transform& childTransform) const;
+
+		//How far the children reach from the object's centre along each of its own axes
+		Vector3 GetLocalHalfSize() const {
+			return localHalfSize;
+		}
+
+		//How far any volume reaches from its centre along each of its own axes
+		static Vector3 GetVolumeHalfSize(const CollisionVolume& volume);
+
+	protected:
+		struct Child {
+			CollisionVolume*	volume;
+			Vector3				localPosition;
+			Quaternion			localOrientation;
+		};
+		std::vector<Child>	children;
+		Vector3				localHalfSize;
+	};
+}
@@ -2,12 +2,36 @@
 
 namespace NCL {
 	namespace CSC8503 {
+		class GameObject;
+
+		//Constraints of a known type can be gathered up and solved in batches,
+		//anything else just has UpdateConstraint called on it
+		enum class ConstraintType {
+			Custom,
+			Distance
+		};
+
 		class Constraint	{
 		public:
-			Constraint() {}
+			Constraint() {
+				type = ConstraintType::Custom;
+			}
 			virtual ~Constraint() {}
 
 			virtual void UpdateConstraint(float dt) = 0;
+
+			//The objects this constraint pushes around, so the physics system
+			//knows which constraints can be solved at the same time. A
+			//constraint that returns nullptr for both is always run on its own.
+			virtual GameObject* GetObjectA() const {
+				return nullptr;
+			}
+
+			virtual GameObject* GetObjectB() const {
+				return nullptr;
+			}
+
+			ConstraintType type;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "ConstraintSolver.h"
+#include "PositionConstraint.h"
+#include "PhysicsObject.h"
+#include "GameObject.h"
+#include "JobSystem.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+static const int		maxColours			= 64;	//one per bit of a body's colour mask
+static const int		overflowColour		= maxColours;	//solved in order on one thread
+static const float		distanceBiasFactor	= 0.01f;
+
+static int BodyIndex(GameObject* o) {
+	return (o && o->GetPhysicsObject()) ? o->GetPhysicsObject()->GetBodyIndex() : -1;
+}
+
+static Vector3 FixedPosition(GameObject* o) {
+	return o ? o->GetConstTransform().GetWorldPosition() : Vector3();
+}
+
+ConstraintSolver::ConstraintSolver()	{
+	colourStarts.push_back(0);
+}
+
+ConstraintSolver::~ConstraintSolver()	{
+}
+
+void ConstraintSolver::Clear() {
+	addedBodiesA.clear();
+	addedBodiesB.clear();
+	addedFixedA.Clear();
+	addedFixedB.Clear();
+	addedDistances.clear();
+	customConstraints.clear();
+}
+
+/*
+A distance constraint with nothing on one end has never done anything, so it
+isn't kept at all.
+*/
+void ConstraintSolver::AddConstraint(Constraint* c) {
+	if (c->type != ConstraintType::Distance) {
+		customConstraints.emplace_back(c);
+		return;
+	}
+	PositionConstraint* p = (PositionConstraint*)c;
+
+	GameObject* a = p->GetObjectA();
+	GameObject* b = p->GetObjectB();
+	if (!a || !b) {
+		return;
+	}
+	int bodyA = BodyIndex(a);
+	int bodyB = BodyIndex(b);
+
+	addedBodiesA.emplace_back(bodyA);
+	addedBodiesB.emplace_back(bodyB);
+	addedFixedA.Add(bodyA < 0 ? FixedPosition(a) : Vector3());
+	addedFixedB.Add(bodyB < 0 ? FixedPosition(b) : Vector3());
+	addedDistances.emplace_back(p->GetDistance());
+}
+
+/*
+Each constraint takes the lowest colour that neither of its bodies has been
+given yet, so the colours come out the same for the same constraints in the
+same order. A body with more constraints on it than there are colours puts
+the rest into the overflow colour, which is never split up.
+*/
+void ConstraintSolver::ColourDistanceConstraints(int bodyCount) {
+	int count = (int)addedBodiesA.size();
+
+	bodyColours.resize(bodyCount, 0);
+
+	for (int i = 0; i < count; ++i) {
+		if (addedColours[i] < 0) {
+			continue;
+		}
+		int a = addedBodiesA[i];
+		int b = addedBodiesB[i];
+
+		uint64_t used = (a >= 0 ? bodyColours[a] : 0) | (b >= 0 ? bodyColours[b] : 0);
+
+		int colour = 0;
+		while (colour < maxColours && (used & ((uint64_t)1 << colour))) {
+			colour++;
+		}
+		addedColours[i] = colour;
+		if (colour < maxColours) {
+			if (a >= 0) {
+				bodyColours[a] |= (uint64_t)1 << colour;
+			}
+			if (b >= 0) {
+				bodyColours[b] |= (uint64_t)1 << colour;
+			}
+		}
+	}
+	//Only the bodies that were touched need clearing for next time
+	for (int i = 0; i < count; ++i) {
+		if (addedBodiesA[i] >= 0) {
+			bodyColours[addedBodiesA[i]] = 0;
+		}
+		if (addedBodiesB[i] >= 0) {
+			bodyColours[addedBodiesB[i]] = 0;
+		}
+	}
+}
+
+/*
+Positions don't move while velocities are being solved, so the direction
+between each pair of objects, and the bias pulling them back to the right
+distance, stay the same for every pass of the step.
+*/
+void ConstraintSolver::Prepare(const PhysicsBodyStore& bodies, float dt) {
+	int count = (int)addedBodiesA.size();
+
+	addedColours.assign(count, 0);
+	addedOffsets.resize(count);
+	addedDirections.x.resize(count);
+	addedDirections.y.resize(count);
+	addedDirections.z.resize(count);
+
+	//Constraints already at their distance, or between two things that can't
+	//move, would never apply any impulse, so they're left out of the batches
+	for (int i = 0; i < count; ++i) {
+		int a = addedBodiesA[i];
+		int b = addedBodiesB[i];
+
+		float massSum = (a >= 0 ? bodies.inverseMasses[a] : 0.0f) + (b >= 0 ? bodies.inverseMasses[b] : 0.0f);
+
+		Vector3 relativePos =
+			(a >= 0 ? bodies.positions.Get(a) : addedFixedA.Get(i)) -
+			(b >= 0 ? bodies.positions.Get(b) : addedFixedB.Get(i));
+
+		float offset = addedDistances[i] - relativePos.Length();
+
+		if (massSum <= 0.0f || offset == 0.0f) {
+			addedColours[i] = -1;
+			continue;
+		}
+		addedDirections.Set(i, relativePos.Normalised());
+		addedOffsets[i] = offset;
+	}
+
+	ColourDistanceConstraints(bodies.GetBodyCount());
+
+	int colourCount = 0;
+	for (int i = 0; i < count; ++i) {
+		colourCount = addedColours[i] + 1 > colourCount ? addedColours[i] + 1 : colourCount;
+	}
+	colourStarts.assign(colourCount + 1, 0);
+	for (int i = 0; i < count; ++i) {
+		if (addedColours[i] >= 0) {
+			colourStarts[addedColours[i] + 1]++;
+		}
+	}
+	for (int i = 0; i < colourCount; ++i) {
+		colourStarts[i + 1] += colourStarts[i];
+	}
+
+	int batchCount = colourStarts[colourCount];
+	bodiesA.resize(batchCount);
+	bodiesB.resize(batchCount);
+	biases.resize(batchCount);
+	inverseMassesA.resize(batchCount);
+	inverseMassesB.resize(batchCount);
+	effectiveMasses.resize(batchCount);
+	directions.x.resize(batchCount);
+	directions.y.resize(batchCount);
+	directions.z.resize(batchCount);
+
+	colourOffsets.assign(colourStarts.begin(), colourStarts.end() - 1);
+	for (int i = 0; i < count; ++i) {
+		if (addedColours[i] < 0) {
+			continue;
+		}
+		int j = colourOffsets[addedColours[i]]++;
+		int a = addedBodiesA[i];
+		int b = addedBodiesB[i];
+
+		bodiesA[j]			= a;
+		bodiesB[j]			= b;
+		inverseMassesA[j]	= a >= 0 ? bodies.inverseMasses[a] : 0.0f;
+		inverseMassesB[j]	= b >= 0 ? bodies.inverseMasses[b] : 0.0f;
+		effectiveMasses[j]	= 1.0f / (inverseMassesA[j] + inverseMassesB[j]);
+		biases[j]			= -(distanceBiasFactor / dt) * addedOffsets[i];
+		directions.Set(j, addedDirections.Get(i));
+	}
+}
+
+void ConstraintSolver::SolveDistanceRange(PhysicsBodyStore& bodies, int begin, int end) {
+	float* vx = bodies.linearVelocities.x.data();
+	float* vy = bodies.linearVelocities.y.data();
+	float* vz = bodies.linearVelocities.z.data();
+
+	for (int i = begin; i < end; ++i) {
+		int a = bodiesA[i];
+		int b = bodiesB[i];
+
+		float nx = directions.x[i];
+		float ny = directions.y[i];
+		float nz = directions.z[i];
+
+		float velocityDot = 0.0f;
+		if (a >= 0) {
+			velocityDot += vx[a] * nx + vy[a] * ny + vz[a] * nz;
+		}
+		if (b >= 0) {
+			velocityDot -= vx[b] * nx + vy[b] * ny + vz[b] * nz;
+		}
+		float lambda = -(velocityDot + biases[i]) * effectiveMasses[i];
+
+		if (a >= 0) {
+			float scale = lambda * inverseMassesA[i];
+			vx[a] += nx * scale;
+			vy[a] += ny * scale;
+			vz[a] += nz * scale;
+		}
+		if (b >= 0) {
+			float scale = lambda * inverseMassesB[i];
+			vx[b] -= nx * scale;
+			vy[b] -= ny * scale;
+			vz[b] -= nz * scale;
+		}
+	}
+}
+
+/*
+One pass over every constraint. Each colour is split between the workers,
+apart from the overflow colour, whose constraints might share bodies.
+*/
+void ConstraintSolver::Solve(PhysicsBodyStore& bodies, JobSystem& jobs, float dt) {
+	int colourCount = GetColourCount();
+
+	for (int colour = 0; colour < colourCount; ++colour) {
+		int start	= colourStarts[colour];
+		int end		= colourStarts[colour + 1];
+
+		if (colour == overflowColour) {
+			SolveDistanceRange(bodies, start, end);
+			continue;
+		}
+		jobs.ParallelFor(end - start, [&](int begin, int rangeEnd, int) {
+			SolveDistanceRange(bodies, start + begin, start + rangeEnd);
+		}, 256);
+	}
+
+	for (Constraint* c : customConstraints) {
+		c->UpdateConstraint(dt);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "PhysicsBodyStore.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	namespace CSC8503 {
+		class Constraint;
+		class JobSystem;
+
+		/*
+		Solves every constraint the physics system is handed each step. The
+		distance constraints (PositionConstraints) are copied out into flat
+		arrays, with everything that can't change while velocities are being
+		solved - the direction between the objects, how hard to pull them back
+		together, and how much each end gives - worked out once per step. Each
+		pass is then just a walk along those arrays, reading and writing body
+		velocities straight from the body store, with no virtual calls or
+		object lookups per link.
+
+		The batch is coloured so that no two constraints of the same colour
+		share a moving body, and sorted by colour. Everything in one colour
+		can therefore be solved at the same time, and the colours taken one
+		after the other. A rope ends up as two colours, each holding every
+		other link.
+
+		Any other kind of constraint is kept in a list, and has
+		UpdateConstraint called on it on the calling thread after the batches.
+		*/
+		class ConstraintSolver	{
+		public:
+			ConstraintSolver();
+			~ConstraintSolver();
+
+			void Clear();
+			//The constraint's objects must already be awake, as waking them moves them in the store
+			void AddConstraint(Constraint* c);
+
+			void Prepare(const PhysicsBodyStore& bodies, float dt);
+			void Solve(PhysicsBodyStore& bodies, JobSystem& jobs, float dt);
+
+			int GetColourCount() const {
+				return (int)colourStarts.size() - 1;
+			}
+
+		protected:
+			void ColourDistanceConstraints(int bodyCount);
+			void SolveDistanceRange(PhysicsBodyStore& bodies, int begin, int end);
+
+			//Straight from the constraints, in the order they were added
+			std::vector<int>	addedBodiesA;	//-1 if that end can't move
+			std::vector<int>	addedBodiesB;
+			Vector3Array		addedFixedA;	//where the ends that can't move are
+			Vector3Array		addedFixedB;
+			std::vector<float>	addedDistances;
+			std::vector<int>	addedColours;
+			std::vector<float>	addedOffsets;
+			Vector3Array		addedDirections;
+
+			//Sorted by colour, with the colour's first entry in colourStarts
+			std::vector<int>	bodiesA;
+			std::vector<int>	bodiesB;
+			Vector3Array		directions;
+			std::vector<float>	biases;
+			std::vector<float>	inverseMassesA;
+			std::vector<float>	inverseMassesB;
+			std::vector<float>	effectiveMasses;
+			std::vector<int>	colourStarts;
+			std::vector<int>	colourOffsets;
+
+			std::vector<uint64_t>	bodyColours; //a bit per colour already touching each body
+
+			std::vector<Constraint*> customConstraints;
+		};
+	}
+}
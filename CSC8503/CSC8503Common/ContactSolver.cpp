@@ -0,0 +1,234 @@
+#include "ContactSolver.h"
+#include "PhysicsObject.h"
+#include "GameObject.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+static const float baumgarte				= 0.2f;	//how much of the penetration to push out each step
+static const float penetrationSlop		= 0.01f;//a little overlap is left alone, so resting contacts don't jitter
+static const float restitutionThreshold	= 1.0f;	//slower impacts than this don't bounce
+static const float matchDistance		= 0.1f;	//how far a point can drift and still count as the same point
+
+static float EffectiveMass(float inverseMassSum, const Matrix3& inertiaA, const Matrix3& inertiaB,
+	const Vector3& relativeA, const Vector3& relativeB, const Vector3& axis) {
+	Vector3 angularA = Vector3::Cross(inertiaA * Vector3::Cross(relativeA, axis), relativeA);
+	Vector3 angularB = Vector3::Cross(inertiaB * Vector3::Cross(relativeB, axis), relativeB);
+
+	float k = inverseMassSum + Vector3::Dot(angularA + angularB, axis);
+	return k > 0.0f ? 1.0f / k : 0.0f;
+}
+
+//Axis aligned boxes can't turn, so are treated as having no inverse inertia at all
+static bool CanRotate(GameObject* object) {
+	const CollisionVolume* volume = object->GetBoundingVolume();
+	return object->GetPhysicsObject()->GetInverseMass() > 0.0f && !(volume && volume->type == VolumeType::AABB);
+}
+
+ContactSolver::ContactSolver()	{
+}
+
+ContactSolver::~ContactSolver()	{
+}
+
+void ContactSolver::SetContactCount(int count) {
+	manifolds.resize(count);
+}
+
+/*
+Works out everything about the manifold that won't change while it's being
+solved - the effective mass along each axis at each point, and how fast each
+point should be separating. That's enough to bounce off anything hitting
+hard enough, or else to push out a fraction of the penetration.
+*/
+void ContactSolver::PrepareContact(int index, CollisionDetection::CollisionInfo& info, float dt) {
+	SolverManifold& m = manifolds[index];
+
+	m.info	= &info;
+	m.physA = info.a->GetPhysicsObject();
+	m.physB = info.b->GetPhysicsObject();
+
+	m.inverseMassA	= m.physA->GetInverseMass();
+	m.inverseMassB	= m.physB->GetInverseMass();
+	m.rotatesA		= CanRotate(info.a);
+	m.rotatesB		= CanRotate(info.b);
+
+	Matrix3 none = Matrix3::Scale(Vector3(0, 0, 0));
+	m.inverseInertiaA = m.rotatesA ? m.physA->GetInertiaTensor() : none;
+	m.inverseInertiaB = m.rotatesB ? m.physB->GetInertiaTensor() : none;
+
+	m.friction = sqrtf(m.physA->GetFriction() * m.physB->GetFriction());
+	float restitution = m.physA->GetElasticity() * m.physB->GetElasticity();
+
+	Vector3 n	= info.points[0].normal;
+	m.normal	= n;
+
+	//Any two axes at right angles to the normal will do for friction
+	m.tangents[0] = fabs(n.x) > 0.57735f ? Vector3(n.y, -n.x, 0.0f) : Vector3(0.0f, n.z, -n.y);
+	m.tangents[0].Normalise();
+	m.tangents[1] = Vector3::Cross(n, m.tangents[0]);
+
+	Vector3 linearA		= m.physA->GetLinearVelocity();
+	Vector3 angularA	= m.physA->GetAngularVelocity();
+	Vector3 linearB		= m.physB->GetLinearVelocity();
+	Vector3 angularB	= m.physB->GetAngularVelocity();
+
+	float inverseMassSum = m.inverseMassA + m.inverseMassB;
+
+	m.pointCount = info.pointCount;
+	for (int i = 0; i < m.pointCount; ++i) {
+		const CollisionDetection::ContactPoint& cp = info.points[i];
+		SolverPoint& p = m.points[i];
+
+		p.relativeA = cp.localA;
+		p.relativeB = cp.localB;
+
+		p.normalMass		= EffectiveMass(inverseMassSum, m.inverseInertiaA, m.inverseInertiaB, p.relativeA, p.relativeB, n);
+		p.tangentMass[0]	= EffectiveMass(inverseMassSum, m.inverseInertiaA, m.inverseInertiaB, p.relativeA, p.relativeB, m.tangents[0]);
+		p.tangentMass[1]	= EffectiveMass(inverseMassSum, m.inverseInertiaA, m.inverseInertiaB, p.relativeA, p.relativeB, m.tangents[1]);
+
+		Vector3 contactVelocity =
+			(linearB + Vector3::Cross(angularB, p.relativeB)) -
+			(linearA + Vector3::Cross(angularA, p.relativeA));
+		float normalVelocity = Vector3::Dot(contactVelocity, n);
+
+		float bounce	= normalVelocity < -restitutionThreshold ? -restitution * normalVelocity : 0.0f;
+		float overlap	= cp.penetration - penetrationSlop;
+		float push		= overlap > 0.0f ? (baumgarte / dt) * overlap : 0.0f;
+		p.bias = bounce > push ? bounce : push;
+
+		p.normalImpulse = cp.normalImpulse;
+		//The normal may have turned a little since last step
+		p.frictionImpulse = cp.frictionImpulse - n * Vector3::Dot(cp.frictionImpulse, n);
+	}
+}
+
+/*
+Applying last step's impulses straight away means a resting stack starts
+off almost solved, rather than having to be rebuilt from nothing each step.
+*/
+void ContactSolver::WarmStart(int index) {
+	SolverManifold& m = manifolds[index];
+
+	Vector3 linearA		= m.physA->GetLinearVelocity();
+	Vector3 angularA	= m.physA->GetAngularVelocity();
+	Vector3 linearB		= m.physB->GetLinearVelocity();
+	Vector3 angularB	= m.physB->GetAngularVelocity();
+
+	for (int i = 0; i < m.pointCount; ++i) {
+		const SolverPoint& p = m.points[i];
+		Vector3 impulse = m.normal * p.normalImpulse + p.frictionImpulse;
+
+		linearA		-= impulse * m.inverseMassA;
+		angularA	-= m.inverseInertiaA * Vector3::Cross(p.relativeA, impulse);
+		linearB		+= impulse * m.inverseMassB;
+		angularB	+= m.inverseInertiaB * Vector3::Cross(p.relativeB, impulse);
+	}
+
+	if (m.inverseMassA > 0.0f) {
+		m.physA->SetLinearVelocity(linearA);
+		if (m.rotatesA) {
+			m.physA->SetAngularVelocity(angularA);
+		}
+	}
+	if (m.inverseMassB > 0.0f) {
+		m.physB->SetLinearVelocity(linearB);
+		if (m.rotatesB) {
+			m.physB->SetAngularVelocity(angularB);
+		}
+	}
+}
+
+/*
+Friction is solved before the normal at each point, as stopping the objects
+sinking into each other matters more, so should have the last word.
+*/
+void ContactSolver::SolveContact(int index) {
+	SolverManifold& m = manifolds[index];
+
+	Vector3 linearA		= m.physA->GetLinearVelocity();
+	Vector3 angularA	= m.physA->GetAngularVelocity();
+	Vector3 linearB		= m.physB->GetLinearVelocity();
+	Vector3 angularB	= m.physB->GetAngularVelocity();
+
+	auto applyImpulse = [&](const SolverPoint& p, const Vector3& impulse) {
+		linearA		-= impulse * m.inverseMassA;
+		angularA	-= m.inverseInertiaA * Vector3::Cross(p.relativeA, impulse);
+		linearB		+= impulse * m.inverseMassB;
+		angularB	+= m.inverseInertiaB * Vector3::Cross(p.relativeB, impulse);
+	};
+	auto contactVelocity = [&](const SolverPoint& p) {
+		return	(linearB + Vector3::Cross(angularB, p.relativeB)) -
+				(linearA + Vector3::Cross(angularA, p.relativeA));
+	};
+
+	for (int i = 0; i < m.pointCount; ++i) {
+		SolverPoint& p = m.points[i];
+
+		Vector3 velocity	= contactVelocity(p);
+		Vector3 oldFriction = p.frictionImpulse;
+		Vector3 friction	= oldFriction -
+			m.tangents[0] * (Vector3::Dot(velocity, m.tangents[0]) * p.tangentMass[0]) -
+			m.tangents[1] * (Vector3::Dot(velocity, m.tangents[1]) * p.tangentMass[1]);
+
+		float maxFriction	= m.friction * p.normalImpulse;
+		float frictionSqr	= friction.LengthSquared();
+		if (frictionSqr > maxFriction * maxFriction) {
+			friction = frictionSqr > 0.0f ? friction * (maxFriction / sqrtf(frictionSqr)) : Vector3();
+		}
+		p.frictionImpulse = friction;
+		applyImpulse(p, friction - oldFriction);
+
+		float normalVelocity	= Vector3::Dot(contactVelocity(p), m.normal);
+		float lambda			= p.normalMass * (p.bias - normalVelocity);
+		float oldImpulse		= p.normalImpulse;
+
+		p.normalImpulse = oldImpulse + lambda > 0.0f ? oldImpulse + lambda : 0.0f;
+		applyImpulse(p, m.normal * (p.normalImpulse - oldImpulse));
+	}
+
+	if (m.inverseMassA > 0.0f) {
+		m.physA->SetLinearVelocity(linearA);
+		if (m.rotatesA) {
+			m.physA->SetAngularVelocity(angularA);
+		}
+	}
+	if (m.inverseMassB > 0.0f) {
+		m.physB->SetLinearVelocity(linearB);
+		if (m.rotatesB) {
+			m.physB->SetAngularVelocity(angularB);
+		}
+	}
+}
+
+void ContactSolver::StoreImpulses(int index) {
+	SolverManifold& m = manifolds[index];
+
+	for (int i = 0; i < m.pointCount; ++i) {
+		m.info->points[i].normalImpulse		= m.points[i].normalImpulse;
+		m.info->points[i].frictionImpulse	= m.points[i].frictionImpulse;
+	}
+}
+
+void ContactSolver::MatchImpulses(CollisionDetection::CollisionInfo& info, const CollisionDetection::CollisionInfo& previous) {
+	if (info.a != previous.a || info.pointCount == 0 || previous.pointCount == 0) {
+		return; //the pair has been flipped around, so last step's impulses point the wrong way
+	}
+	if (Vector3::Dot(info.points[0].normal, previous.points[0].normal) < 0.95f) {
+		return;
+	}
+	for (int i = 0; i < info.pointCount; ++i) {
+		CollisionDetection::ContactPoint& point = info.points[i];
+
+		float bestDistance = matchDistance * matchDistance;
+		for (int j = 0; j < previous.pointCount; ++j) {
+			float distance = (point.localA - previous.points[j].localA).LengthSquared();
+			if (distance < bestDistance) {
+				bestDistance			= distance;
+				point.normalImpulse		= previous.points[j].normalImpulse;
+				point.frictionImpulse	= previous.points[j].frictionImpulse;
+			}
+		}
+	}
+}
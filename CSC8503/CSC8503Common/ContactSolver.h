@@ -0,0 +1,71 @@
+#pragma once
+#include "CollisionDetection.h"
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		class PhysicsObject;
+
+		/*
+		A sequential impulse solver for contact manifolds. Each step, every
+		manifold is prepared once, given back the impulses its points ended
+		the last step with (warm starting), and then solved a few times over.
+		Each pass works out how much more impulse each point needs, but it is
+		the running total per point that gets clamped - never pulling the
+		objects together, and never giving more friction than the normal
+		impulse allows - so later passes can take back some of what earlier
+		ones did.
+
+		Manifolds are only ever touched by index, so different threads can
+		solve different manifolds as long as they share no moving bodies.
+		*/
+		class ContactSolver	{
+		public:
+			ContactSolver();
+			~ContactSolver();
+
+			void SetContactCount(int count);
+
+			void PrepareContact(int index, CollisionDetection::CollisionInfo& info, float dt);
+			void WarmStart(int index);
+			void SolveContact(int index);
+			void StoreImpulses(int index);
+
+			//Carries impulses over from last step's points that are still in about the same place
+			static void MatchImpulses(CollisionDetection::CollisionInfo& info, const CollisionDetection::CollisionInfo& previous);
+
+		protected:
+			struct SolverPoint {
+				Vector3 relativeA;
+				Vector3 relativeB;
+				float	normalMass;
+				float	tangentMass[2];
+				float	bias;
+				float	normalImpulse;
+				Vector3 frictionImpulse;
+			};
+
+			struct SolverManifold {
+				CollisionDetection::CollisionInfo* info;
+
+				PhysicsObject*	physA;
+				PhysicsObject*	physB;
+				float			inverseMassA;
+				float			inverseMassB;
+				Matrix3			inverseInertiaA;
+				Matrix3			inverseInertiaB;
+				bool			rotatesA;
+				bool			rotatesB;
+
+				Vector3			normal;
+				Vector3			tangents[2];
+				float			friction;
+
+				int				pointCount;
+				SolverPoint		points[CollisionDetection::MAX_CONTACT_POINTS];
+			};
+
+			std::vector<SolverManifold> manifolds;
+		};
+	}
+}
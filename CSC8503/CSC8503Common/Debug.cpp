@@ -32,6 +32,8 @@ void Debug::FlushRenderables() {
 	if (!renderer) {
 		return;
 	}
+	//The GL renderer only exists in the Windows build
+#ifdef _WIN32
 	for (const auto& i : stringEntries) {
 		renderer->DrawString(i.data, i.position);
 	}
@@ -39,6 +41,7 @@ void Debug::FlushRenderables() {
 	for (const auto& i : lineEntries) {
 		renderer->DrawLine(i.start, i.end, i.colour);
 	}
+#endif
 
 	stringEntries.clear();
 	lineEntries.clear();
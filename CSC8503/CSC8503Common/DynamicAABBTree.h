@@ -0,0 +1,603 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "PhysicsSimd.h"
+#include <vector>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		/*
+		A world space box used by the broadphase. Unlike an AABBVolume, this stores
+		its extents directly, so that merging and containment tests are cheap.
+		*/
+		struct BroadphaseBounds {
+			Vector3 min;
+			Vector3 max;
+
+			BroadphaseBounds() {}
+
+			BroadphaseBounds(const Vector3& pos, const Vector3& halfSize) {
+				min = pos - halfSize;
+				max = pos + halfSize;
+			}
+
+			bool Overlaps(const BroadphaseBounds& other) const {
+				return	min.x <= other.max.x && max.x >= other.min.x &&
+						min.y <= other.max.y && max.y >= other.min.y &&
+						min.z <= other.max.z && max.z >= other.min.z;
+			}
+
+			bool Contains(const BroadphaseBounds& other) const {
+				return	min.x <= other.min.x && max.x >= other.max.x &&
+						min.y <= other.min.y && max.y >= other.max.y &&
+						min.z <= other.min.z && max.z >= other.max.z;
+			}
+
+			/*
+			Slab test for a ray, given 1 / its direction, which is worked out once
+			per ray rather than once per box. Gives how far along the ray it
+			enters the box, if it does so before maxDistance.
+			*/
+			bool RayTest(const Vector3& start, const Vector3& inverseDirection, float maxDistance, float& enter) const {
+				float tMin = 0.0f;
+				float tMax = maxDistance;
+				for (int i = 0; i < 3; ++i) {
+					float t0 = (min[i] - start[i]) * inverseDirection[i];
+					float t1 = (max[i] - start[i]) * inverseDirection[i];
+					if (t0 > t1) {
+						float t = t0;
+						t0 = t1;
+						t1 = t;
+					}
+					tMin = t0 > tMin ? t0 : tMin;
+					tMax = t1 < tMax ? t1 : tMax;
+					if (tMin > tMax) {
+						return false;
+					}
+				}
+				enter = tMin;
+				return true;
+			}
+
+			//Half the surface area is all the tree cost heuristic needs
+			float GetHalfArea() const {
+				Vector3 d = max - min;
+				return (d.x * d.y) + (d.y * d.z) + (d.z * d.x);
+			}
+
+			static BroadphaseBounds Merge(const BroadphaseBounds& a, const BroadphaseBounds& b) {
+				BroadphaseBounds out;
+				out.min = Vector3(a.min.x < b.min.x ? a.min.x : b.min.x,
+								  a.min.y < b.min.y ? a.min.y : b.min.y,
+								  a.min.z < b.min.z ? a.min.z : b.min.z);
+				out.max = Vector3(a.max.x > b.max.x ? a.max.x : b.max.x,
+								  a.max.y > b.max.y ? a.max.y : b.max.y,
+								  a.max.z > b.max.z ? a.max.z : b.max.z);
+				return out;
+			}
+		};
+
+		/*
+		Up to 32 rays, stored a component at a time so that a box can be tested
+		against several of them at once. Unused rays have a negative length, as
+		do rays that have finished, so they never enter anything.
+		*/
+		struct BroadphaseRayPacket {
+			static const int maxRays = 32;
+
+			float	startX[maxRays];
+			float	startY[maxRays];
+			float	startZ[maxRays];
+			float	inverseX[maxRays];
+			float	inverseY[maxRays];
+			float	inverseZ[maxRays];
+			float	maxDistances[maxRays];
+			Vector3 directions[maxRays];
+			int		rayCount;
+
+			BroadphaseRayPacket() {
+				rayCount = 0;
+				for (int i = 0; i < maxRays; ++i) {
+					startX[i]	= startY[i]		= startZ[i]		= 0.0f;
+					inverseX[i] = inverseY[i]	= inverseZ[i]	= 0.0f;
+					maxDistances[i] = -1.0f;
+				}
+			}
+
+			void SetRay(int ray, const Vector3& start, const Vector3& direction, float maxDistance) {
+				startX[ray] = start.x;
+				startY[ray] = start.y;
+				startZ[ray] = start.z;
+				//Dividing by a zero component gives an infinity, which the slab test copes with
+				inverseX[ray] = 1.0f / direction.x;
+				inverseY[ray] = 1.0f / direction.y;
+				inverseZ[ray] = 1.0f / direction.z;
+				maxDistances[ray]	= maxDistance;
+				directions[ray]		= direction;
+			}
+
+			//A bit per ray that enters the box before its maxDistance
+			unsigned int RayTest(const BroadphaseBounds& b) const {
+				unsigned int hits = 0;
+#if PHYSICS_SIMD_WIDTH > 1
+				SimdFloat minX = SimdSet(b.min.x), minY = SimdSet(b.min.y), minZ = SimdSet(b.min.z);
+				SimdFloat maxX = SimdSet(b.max.x), maxY = SimdSet(b.max.y), maxZ = SimdSet(b.max.z);
+				for (int i = 0; i < rayCount; i += PHYSICS_SIMD_WIDTH) {
+					SimdFloat tMin = SimdSet(0.0f);
+					SimdFloat tMax = SimdLoad(&maxDistances[i]);
+					SimdFloat s		= SimdLoad(&startX[i]);
+					SimdFloat inv	= SimdLoad(&inverseX[i]);
+					SimdFloat t0	= SimdMul(SimdSub(minX, s), inv);
+					SimdFloat t1	= SimdMul(SimdSub(maxX, s), inv);
+					//The running values go second, so a NaN from 0 * infinity leaves them alone
+					tMin = SimdMax(SimdMin(t0, t1), tMin);
+					tMax = SimdMin(SimdMax(t0, t1), tMax);
+
+					s	= SimdLoad(&startY[i]);
+					inv = SimdLoad(&inverseY[i]);
+					t0	= SimdMul(SimdSub(minY, s), inv);
+					t1	= SimdMul(SimdSub(maxY, s), inv);
+					tMin = SimdMax(SimdMin(t0, t1), tMin);
+					tMax = SimdMin(SimdMax(t0, t1), tMax);
+
+					s	= SimdLoad(&startZ[i]);
+					inv = SimdLoad(&inverseZ[i]);
+					t0	= SimdMul(SimdSub(minZ, s), inv);
+					t1	= SimdMul(SimdSub(maxZ, s), inv);
+					tMin = SimdMax(SimdMin(t0, t1), tMin);
+					tMax = SimdMin(SimdMax(t0, t1), tMax);
+
+					unsigned int misses = (unsigned int)SimdMask(SimdGreater(tMin, tMax));
+					hits |= (~misses & ((1u << PHYSICS_SIMD_WIDTH) - 1)) << i;
+				}
+#else
+				for (int i = 0; i < rayCount; ++i) {
+					float enter;
+					if (b.RayTest(Vector3(startX[i], startY[i], startZ[i]), Vector3(inverseX[i], inverseY[i], inverseZ[i]), maxDistances[i], enter)) {
+						hits |= 1u << i;
+					}
+				}
+#endif
+				return rayCount == maxRays ? hits : hits & ((1u << rayCount) - 1);
+			}
+		};
+
+		template<class T>
+		struct DynamicAABBTreeNode {
+			BroadphaseBounds bounds;
+			T	object;
+			int parent;	//doubles up as the 'next' link while on the free list
+			int left;
+			int right;
+			int height;	//-1 while on the free list
+
+			bool IsLeaf() const {
+				return left == -1;
+			}
+		};
+
+		/*
+		A bounding volume hierarchy that persists across frames. Each object gets
+		a 'proxy' handle when inserted, and is stored with a 'fat' box slightly
+		larger than its real bounds - as long as the object stays inside its fat
+		box, moving it costs nothing more than a containment test. Only when it
+		escapes is its leaf pulled out and reinserted. The tree is kept balanced
+		with AVL style rotations, so queries stay logarithmic.
+		*/
+		template<class T>
+		class DynamicAABBTree {
+		public:
+			DynamicAABBTree(float fatMargin = 0.5f) {
+				margin	= fatMargin;
+				root	= -1;
+				freeList = -1;
+				proxyCount = 0;
+			}
+			~DynamicAABBTree() {
+			}
+
+			void Clear() {
+				nodes.clear();
+				root		= -1;
+				freeList	= -1;
+				proxyCount	= 0;
+			}
+
+			int InsertProxy(T object, const Vector3& pos, const Vector3& halfSize) {
+				int proxy = AllocateNode();
+				nodes[proxy].bounds = BroadphaseBounds(pos, halfSize + Vector3(margin, margin, margin));
+				nodes[proxy].object = object;
+				nodes[proxy].height = 0;
+				InsertLeaf(proxy);
+				proxyCount++;
+				return proxy;
+			}
+
+			void RemoveProxy(int proxy) {
+				RemoveLeaf(proxy);
+				FreeNode(proxy);
+				proxyCount--;
+			}
+
+			/*
+			Returns true if the proxy had to be reinserted. The displacement is used
+			to stretch the new fat box in the direction of travel, so that fast
+			movers don't immediately escape it again next frame.
+			*/
+			bool MoveProxy(int proxy, const Vector3& pos, const Vector3& halfSize, const Vector3& displacement) {
+				BroadphaseBounds tight(pos, halfSize);
+				if (nodes[proxy].bounds.Contains(tight)) {
+					return false;
+				}
+				RemoveLeaf(proxy);
+
+				BroadphaseBounds fat(pos, halfSize + Vector3(margin, margin, margin));
+				for (int i = 0; i < 3; ++i) {
+					if (displacement[i] < 0.0f) {
+						fat.min[i] += displacement[i];
+					}
+					else {
+						fat.max[i] += displacement[i];
+					}
+				}
+				nodes[proxy].bounds = fat;
+				InsertLeaf(proxy);
+				return true;
+			}
+
+			T& GetObject(int proxy) {
+				return nodes[proxy].object;
+			}
+
+			const T& GetObject(int proxy) const {
+				return nodes[proxy].object;
+			}
+
+			const BroadphaseBounds& GetFatBounds(int proxy) const {
+				return nodes[proxy].bounds;
+			}
+
+			int GetProxyCount() const {
+				return proxyCount;
+			}
+
+			int GetHeight() const {
+				return root == -1 ? 0 : nodes[root].height;
+			}
+
+			/*
+			Calls func(proxy) for every leaf whose fat box overlaps the given box.
+			If func returns false, the query stops early.
+			*/
+			template<class F>
+			void Query(const BroadphaseBounds& bounds, F func) const {
+				if (root == -1) {
+					return;
+				}
+				//The tree is balanced, so this is plenty for any sane proxy count
+				int stack[128];
+				int stackSize = 0;
+				stack[stackSize++] = root;
+
+				while (stackSize > 0) {
+					int id = stack[--stackSize];
+					const DynamicAABBTreeNode<T>& n = nodes[id];
+					if (!n.bounds.Overlaps(bounds)) {
+						continue;
+					}
+					if (n.IsLeaf()) {
+						if (!func(id)) {
+							return;
+						}
+					}
+					else {
+						stack[stackSize++] = n.left;
+						stack[stackSize++] = n.right;
+					}
+				}
+			}
+
+			/*
+			Calls func(proxy, maxDistance) for every leaf whose fat box the ray
+			enters before maxDistance, nearest branches first. func can shorten
+			maxDistance as it finds hits, which stops anything further away
+			being visited, or return false to stop the walk altogether.
+			*/
+			template<class F>
+			void RayCast(const Vector3& start, const Vector3& direction, float maxDistance, F func) const {
+				if (root == -1) {
+					return;
+				}
+				//Dividing by a zero component gives an infinity, which the slab test copes with
+				Vector3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+				int stack[128];
+				int stackSize = 0;
+				stack[stackSize++] = root;
+
+				while (stackSize > 0) {
+					int id = stack[--stackSize];
+					const DynamicAABBTreeNode<T>& n = nodes[id];
+					float enter;
+					if (!n.bounds.RayTest(start, inverseDirection, maxDistance, enter)) {
+						continue;
+					}
+					if (n.IsLeaf()) {
+						if (!func(id, maxDistance)) {
+							return;
+						}
+						continue;
+					}
+					float enterLeft		= 0.0f;
+					float enterRight	= 0.0f;
+					bool hitLeft	= nodes[n.left].bounds.RayTest(start, inverseDirection, maxDistance, enterLeft);
+					bool hitRight	= nodes[n.right].bounds.RayTest(start, inverseDirection, maxDistance, enterRight);
+					if (hitLeft && hitRight) {
+						stack[stackSize++] = enterLeft < enterRight ? n.right : n.left;
+						stack[stackSize++] = enterLeft < enterRight ? n.left : n.right;
+					}
+					else if (hitLeft) {
+						stack[stackSize++] = n.left;
+					}
+					else if (hitRight) {
+						stack[stackSize++] = n.right;
+					}
+				}
+			}
+
+			/*
+			Walks a packet of rays down the tree together, so each node is only
+			fetched once for all the rays that reach it, and tested against
+			several rays at once. Calls func(proxy, ray, maxDistance) for each
+			ray entering a leaf, which can shorten that ray's maxDistance, or
+			return false to drop the ray from the rest of the walk. Packets work
+			best when their rays start near each other and head roughly the same
+			way, as for a character's line of sight checks.
+			*/
+			template<class F>
+			void RayCastPacket(const BroadphaseRayPacket& rays, F func) const {
+				if (root == -1 || rays.rayCount <= 0) {
+					return;
+				}
+				BroadphaseRayPacket packet = rays;
+
+				//Each entry carries the rays that entered its parent
+				int				stack[128];
+				unsigned int	stackRays[128];
+				int stackSize = 0;
+				stack[stackSize]		= root;
+				stackRays[stackSize++]	= ~0u;
+
+				while (stackSize > 0) {
+					int id = stack[--stackSize];
+					const DynamicAABBTreeNode<T>& n = nodes[id];
+					unsigned int hitRays = stackRays[stackSize] & packet.RayTest(n.bounds);
+					if (hitRays == 0) {
+						continue;
+					}
+					if (n.IsLeaf()) {
+						for (int i = 0; i < packet.rayCount; ++i) {
+							if ((hitRays & (1u << i)) && !func(id, i, packet.maxDistances[i])) {
+								packet.maxDistances[i] = -1.0f;
+							}
+						}
+						continue;
+					}
+					//Rays in a packet mostly head the same way, so whichever child is
+					//nearer along the first ray's direction goes on top
+					int first = 0;
+					while (!(hitRays & (1u << first))) {
+						first++;
+					}
+					const BroadphaseBounds& left	= nodes[n.left].bounds;
+					const BroadphaseBounds& right	= nodes[n.right].bounds;
+					bool leftNearer = Vector3::Dot((left.min + left.max) - (right.min + right.max), packet.directions[first]) < 0.0f;
+
+					stack[stackSize]		= leftNearer ? n.right : n.left;
+					stackRays[stackSize++]	= hitRays;
+					stack[stackSize]		= leftNearer ? n.left : n.right;
+					stackRays[stackSize++]	= hitRays;
+				}
+			}
+
+		protected:
+			int AllocateNode() {
+				int id;
+				if (freeList != -1) {
+					id = freeList;
+					freeList = nodes[id].parent;
+				}
+				else {
+					id = (int)nodes.size();
+					nodes.emplace_back();
+				}
+				nodes[id].parent	= -1;
+				nodes[id].left		= -1;
+				nodes[id].right		= -1;
+				nodes[id].height	= 0;
+				return id;
+			}
+
+			void FreeNode(int id) {
+				nodes[id].parent = freeList;
+				nodes[id].height = -1;
+				freeList = id;
+			}
+
+			void InsertLeaf(int leaf) {
+				if (root == -1) {
+					root = leaf;
+					nodes[root].parent = -1;
+					return;
+				}
+				//Walk down the tree, picking the child that grows the least
+				const BroadphaseBounds leafBounds = nodes[leaf].bounds;
+				int index = root;
+				while (!nodes[index].IsLeaf()) {
+					int left	= nodes[index].left;
+					int right	= nodes[index].right;
+
+					float area			= nodes[index].bounds.GetHalfArea();
+					float combinedArea	= BroadphaseBounds::Merge(nodes[index].bounds, leafBounds).GetHalfArea();
+
+					float cost			= 2.0f * combinedArea;
+					float inheritance	= 2.0f * (combinedArea - area);
+
+					float costLeft	= ChildCost(left, leafBounds) + inheritance;
+					float costRight = ChildCost(right, leafBounds) + inheritance;
+
+					if (cost < costLeft && cost < costRight) {
+						break;
+					}
+					index = (costLeft < costRight) ? left : right;
+				}
+				int sibling		= index;
+				int oldParent	= nodes[sibling].parent;
+				int newParent	= AllocateNode();
+				nodes[newParent].parent = oldParent;
+				nodes[newParent].bounds = BroadphaseBounds::Merge(leafBounds, nodes[sibling].bounds);
+				nodes[newParent].height = nodes[sibling].height + 1;
+				nodes[newParent].left	= sibling;
+				nodes[newParent].right	= leaf;
+				nodes[sibling].parent	= newParent;
+				nodes[leaf].parent		= newParent;
+
+				if (oldParent != -1) {
+					if (nodes[oldParent].left == sibling) {
+						nodes[oldParent].left = newParent;
+					}
+					else {
+						nodes[oldParent].right = newParent;
+					}
+				}
+				else {
+					root = newParent;
+				}
+				Refit(nodes[leaf].parent);
+			}
+
+			void RemoveLeaf(int leaf) {
+				if (leaf == root) {
+					root = -1;
+					return;
+				}
+				int parent		= nodes[leaf].parent;
+				int grandParent = nodes[parent].parent;
+				int sibling		= (nodes[parent].left == leaf) ? nodes[parent].right : nodes[parent].left;
+
+				if (grandParent != -1) {
+					if (nodes[grandParent].left == parent) {
+						nodes[grandParent].left = sibling;
+					}
+					else {
+						nodes[grandParent].right = sibling;
+					}
+					nodes[sibling].parent = grandParent;
+					FreeNode(parent);
+					Refit(grandParent);
+				}
+				else {
+					root = sibling;
+					nodes[sibling].parent = -1;
+					FreeNode(parent);
+				}
+			}
+
+			float ChildCost(int child, const BroadphaseBounds& leafBounds) const {
+				float merged = BroadphaseBounds::Merge(nodes[child].bounds, leafBounds).GetHalfArea();
+				if (nodes[child].IsLeaf()) {
+					return merged;
+				}
+				return merged - nodes[child].bounds.GetHalfArea();
+			}
+
+			//Walks back up to the root, rebalancing and refitting as it goes
+			void Refit(int index) {
+				while (index != -1) {
+					index = Balance(index);
+
+					int left	= nodes[index].left;
+					int right	= nodes[index].right;
+
+					int lh = nodes[left].height;
+					int rh = nodes[right].height;
+					nodes[index].height = 1 + (lh > rh ? lh : rh);
+					nodes[index].bounds = BroadphaseBounds::Merge(nodes[left].bounds, nodes[right].bounds);
+
+					index = nodes[index].parent;
+				}
+			}
+
+			//Rotates the subtree at a if it is unbalanced, returning its new root
+			int Balance(int a) {
+				DynamicAABBTreeNode<T>& A = nodes[a];
+				if (A.IsLeaf() || A.height < 2) {
+					return a;
+				}
+				int b = A.left;
+				int c = A.right;
+				int balance = nodes[c].height - nodes[b].height;
+
+				if (balance > 1) {
+					return Rotate(a, c, b);
+				}
+				if (balance < -1) {
+					return Rotate(a, b, c);
+				}
+				return a;
+			}
+
+			//Promotes the taller child 'up' above a, handing a its best grandchild
+			int Rotate(int a, int up, int other) {
+				int f = nodes[up].left;
+				int g = nodes[up].right;
+
+				nodes[up].left		= a;
+				nodes[up].parent	= nodes[a].parent;
+				nodes[a].parent		= up;
+
+				if (nodes[up].parent != -1) {
+					if (nodes[nodes[up].parent].left == a) {
+						nodes[nodes[up].parent].left = up;
+					}
+					else {
+						nodes[nodes[up].parent].right = up;
+					}
+				}
+				else {
+					root = up;
+				}
+
+				int keep	= f;
+				int give	= g;
+				if (nodes[f].height <= nodes[g].height) {
+					keep = g;
+					give = f;
+				}
+				nodes[up].right		= keep;
+				if (nodes[a].left == up) {
+					nodes[a].left = give;
+				}
+				else {
+					nodes[a].right = give;
+				}
+				nodes[give].parent = a;
+
+				nodes[a].bounds = BroadphaseBounds::Merge(nodes[other].bounds, nodes[give].bounds);
+				nodes[up].bounds = BroadphaseBounds::Merge(nodes[a].bounds, nodes[keep].bounds);
+
+				int ah = nodes[other].height > nodes[give].height ? nodes[other].height : nodes[give].height;
+				nodes[a].height = 1 + ah;
+				nodes[up].height = 1 + (nodes[a].height > nodes[keep].height ? nodes[a].height : nodes[keep].height);
+
+				return up;
+			}
+
+			std::vector<DynamicAABBTreeNode<T>> nodes;
+			int		root;
+			int		freeList;
+			int		proxyCount;
+			float	margin;
+		};
+	}
+}
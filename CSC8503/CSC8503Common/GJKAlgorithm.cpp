@@ -0,0 +1,578 @@
+#include "GJKAlgorithm.h"
+#include "Transform.h"
+#include "../../Common/Matrix3.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+using namespace CSC8503;
+
+typedef Simplex::SupportPoint SupportPoint;
+
+static const int	maxGJKIterations	= 64;
+static const int	maxEPAIterations	= 64;
+static const int	maxEPAVertices		= maxEPAIterations + 4;
+static const int	maxEPAFaces			= maxEPAVertices * 2;
+static const float	gjkTolerance		= 1e-6f;
+static const float	epaTolerance		= 1e-4f;
+
+/*
+A volume placed in the world, ready to be asked for support points. The core
+is the shape without its margin, so for a sphere it's just the centre point.
+A shape can also be a lone triangle out of a mesh, in which case it has no
+volume, and its position is the centre of the mesh it came from, so that its
+contacts come out relative to that.
+*/
+struct ConvexShape {
+	const CollisionVolume*	volume;
+	Vector3		position;
+	Vector3		centre;
+	Matrix3		orientation;
+	Matrix3		inverseOrientation;
+	Vector3		halfSize;
+	Vector3		triangle[3];
+	float		margin;
+
+	ConvexShape(const Vector3* corners, const Vector3& origin) {
+		volume		= nullptr;
+		position	= origin;
+		centre		= (corners[0] + corners[1] + corners[2]) / 3.0f;
+		margin		= 0.0f;
+		for (int i = 0; i < 3; ++i) {
+			triangle[i] = corners[i];
+		}
+	}
+
+	ConvexShape(const CollisionVolume& v, const Transform& t) {
+		volume		= &v;
+		position	= t.GetWorldPosition();
+		centre		= position;
+		margin		= 0.0f;
+
+		switch (v.type) {
+			case VolumeType::Sphere: {
+				margin = ((const SphereVolume&)v).GetRadius();
+			}break;
+			case VolumeType::AABB: {
+				halfSize = ((const AABBVolume&)v).GetHalfDimensions();
+			}break;
+			case VolumeType::OBB: {
+				halfSize			= ((const OBBVolume&)v).GetHalfDimensions();
+				orientation			= Matrix3(t.GetWorldOrientation());
+				inverseOrientation	= orientation.Transposed();
+			}break;
+			default:
+				break;
+		}
+	}
+
+	Vector3 CoreSupport(const Vector3& dir) const {
+		if (!volume) {
+			float d0 = Vector3::Dot(triangle[0], dir);
+			float d1 = Vector3::Dot(triangle[1], dir);
+			float d2 = Vector3::Dot(triangle[2], dir);
+			if (d0 >= d1 && d0 >= d2) {
+				return triangle[0];
+			}
+			return d1 >= d2 ? triangle[1] : triangle[2];
+		}
+		switch (volume->type) {
+			case VolumeType::AABB: {
+				return position + Vector3(
+					dir.x < 0.0f ? -halfSize.x : halfSize.x,
+					dir.y < 0.0f ? -halfSize.y : halfSize.y,
+					dir.z < 0.0f ? -halfSize.z : halfSize.z);
+			}
+			case VolumeType::OBB: {
+				Vector3 local = inverseOrientation * dir;
+				return position + orientation * Vector3(
+					local.x < 0.0f ? -halfSize.x : halfSize.x,
+					local.y < 0.0f ? -halfSize.y : halfSize.y,
+					local.z < 0.0f ? -halfSize.z : halfSize.z);
+			}
+			default:
+				break;
+		}
+		return position; //a sphere's core is just its centre
+	}
+};
+
+//The point of the Minkowski difference A - B furthest along dir
+static SupportPoint Support(const ConvexShape& a, const ConvexShape& b, const Vector3& dir) {
+	SupportPoint p;
+	p.onA	= a.CoreSupport(dir);
+	p.onB	= b.CoreSupport(-dir);
+	p.pos	= p.onA - p.onB;
+	p.realA = p.onA;
+	p.realB = p.onB;
+	return p;
+}
+
+static void KeepPoints(SupportPoint* simplex, float* weights, int& size, int i0, float w0, int i1 = -1, float w1 = 0.0f, int i2 = -1, float w2 = 0.0f) {
+	SupportPoint kept[3] = { simplex[i0], i1 >= 0 ? simplex[i1] : simplex[i0], i2 >= 0 ? simplex[i2] : simplex[i0] };
+	simplex[0] = kept[0]; weights[0] = w0;
+	simplex[1] = kept[1]; weights[1] = w1;
+	simplex[2] = kept[2]; weights[2] = w2;
+	size = i2 >= 0 ? 3 : (i1 >= 0 ? 2 : 1);
+}
+
+static void ClosestOnSegment(SupportPoint* s, float* w, int& size) {
+	Vector3 ab = s[1].pos - s[0].pos;
+	float lengthSqr = Vector3::Dot(ab, ab);
+	float t = lengthSqr > 0.0f ? -Vector3::Dot(s[0].pos, ab) / lengthSqr : 0.0f;
+
+	if (t <= 0.0f) {
+		KeepPoints(s, w, size, 0, 1.0f);
+	}
+	else if (t >= 1.0f) {
+		KeepPoints(s, w, size, 1, 1.0f);
+	}
+	else {
+		KeepPoints(s, w, size, 0, 1.0f - t, 1, t);
+	}
+}
+
+//Works out which region of the triangle the origin is closest to, as in Real-Time Collision Detection 5.1.5
+static void ClosestOnTriangle(SupportPoint* s, float* w, int& size) {
+	const Vector3& a = s[0].pos;
+	const Vector3& b = s[1].pos;
+	const Vector3& c = s[2].pos;
+
+	Vector3 ab = b - a;
+	Vector3 ac = c - a;
+
+	float d1 = Vector3::Dot(ab, -a);
+	float d2 = Vector3::Dot(ac, -a);
+	if (d1 <= 0.0f && d2 <= 0.0f) {
+		KeepPoints(s, w, size, 0, 1.0f);
+		return;
+	}
+	float d3 = Vector3::Dot(ab, -b);
+	float d4 = Vector3::Dot(ac, -b);
+	if (d3 >= 0.0f && d4 <= d3) {
+		KeepPoints(s, w, size, 1, 1.0f);
+		return;
+	}
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		float t = d1 / (d1 - d3);
+		KeepPoints(s, w, size, 0, 1.0f - t, 1, t);
+		return;
+	}
+	float d5 = Vector3::Dot(ab, -c);
+	float d6 = Vector3::Dot(ac, -c);
+	if (d6 >= 0.0f && d5 <= d6) {
+		KeepPoints(s, w, size, 2, 1.0f);
+		return;
+	}
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		float t = d2 / (d2 - d6);
+		KeepPoints(s, w, size, 0, 1.0f - t, 2, t);
+		return;
+	}
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		KeepPoints(s, w, size, 1, 1.0f - t, 2, t);
+		return;
+	}
+	float denom = 1.0f / (va + vb + vc);
+	float v = vb * denom;
+	float u = vc * denom;
+	KeepPoints(s, w, size, 0, 1.0f - v - u, 1, v, 2, u);
+}
+
+/*
+The origin is either inside the tetrahedron, in which case all 4 points are
+kept, or closest to one of the faces it is in front of.
+*/
+static void ClosestOnTetrahedron(SupportPoint* s, float* w, int& size) {
+	static const int faces[4][4] = { {0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0} };
+
+	float			bestDistance = FLT_MAX;
+	SupportPoint	bestPoints[3];
+	float			bestWeights[3];
+	int				bestSize	= 0;
+
+	for (int f = 0; f < 4; ++f) {
+		const Vector3& a = s[faces[f][0]].pos;
+		Vector3 normal = Vector3::Cross(s[faces[f][1]].pos - a, s[faces[f][2]].pos - a);
+
+		float originSide	= Vector3::Dot(-a, normal);
+		float oppositeSide	= Vector3::Dot(s[faces[f][3]].pos - a, normal);
+
+		if (originSide * oppositeSide > 0.0f) {
+			continue; //the origin is on the inside of this face
+		}
+		SupportPoint	tri[3] = { s[faces[f][0]], s[faces[f][1]], s[faces[f][2]] };
+		float			triWeights[3];
+		int				triSize = 3;
+		ClosestOnTriangle(tri, triWeights, triSize);
+
+		Vector3 closest;
+		for (int i = 0; i < triSize; ++i) {
+			closest += tri[i].pos * triWeights[i];
+		}
+		float distance = closest.LengthSquared();
+		if (distance < bestDistance) {
+			bestDistance = distance;
+			bestSize	 = triSize;
+			for (int i = 0; i < triSize; ++i) {
+				bestPoints[i]	= tri[i];
+				bestWeights[i]	= triWeights[i];
+			}
+		}
+	}
+	if (bestSize == 0) {
+		return; //inside all 4 faces
+	}
+	size = bestSize;
+	for (int i = 0; i < bestSize; ++i) {
+		s[i] = bestPoints[i];
+		w[i] = bestWeights[i];
+	}
+}
+
+enum class GJKResult {
+	Separated,	//further apart than the margins
+	Touching,	//the cores are apart, but the margins overlap
+	Overlapping	//the cores themselves overlap
+};
+
+/*
+Runs GJK on the shapes' cores. On return, the simplex holds the points
+closest to the origin, with the weights that give the closest point, or
+encloses the origin if the cores overlap.
+*/
+static GJKResult RunGJK(const ConvexShape& a, const ConvexShape& b, SupportPoint* simplex, float* weights, int& size, Vector3& v,
+	Vector3* separatingAxis, bool stopWhenSeparated = true) {
+	float margins = a.margin + b.margin;
+
+	v = (separatingAxis && separatingAxis->LengthSquared() > 0.0f) ? *separatingAxis : a.centre - b.centre;
+	if (v.LengthSquared() == 0.0f) {
+		v = Vector3(1, 0, 0);
+	}
+	size = 0;
+
+	for (int i = 0; i < maxGJKIterations; ++i) {
+		SupportPoint p = Support(a, b, -v);
+
+		//Everything in the difference is at least this far along v, so if
+		//that's past the margins there's a gap between the shapes
+		float vDotP = Vector3::Dot(v, p.pos);
+		if (stopWhenSeparated && vDotP > 0.0f && vDotP * vDotP > v.LengthSquared() * margins * margins) {
+			if (separatingAxis) {
+				*separatingAxis = v;
+			}
+			return GJKResult::Separated;
+		}
+		//Not getting any closer, so v is as close as it gets
+		if (size > 0 && v.LengthSquared() - vDotP <= gjkTolerance * v.LengthSquared()) {
+			break;
+		}
+		simplex[size++] = p;
+
+		switch (size) {
+			case 1: weights[0] = 1.0f; break;
+			case 2: ClosestOnSegment(simplex, weights, size); break;
+			case 3: ClosestOnTriangle(simplex, weights, size); break;
+			case 4: ClosestOnTetrahedron(simplex, weights, size); break;
+		}
+		if (size == 4) {
+			return GJKResult::Overlapping;
+		}
+		v = Vector3();
+		for (int j = 0; j < size; ++j) {
+			v += simplex[j].pos * weights[j];
+		}
+		if (v.LengthSquared() < gjkTolerance * gjkTolerance) {
+			return GJKResult::Overlapping;
+		}
+	}
+	if (separatingAxis) {
+		*separatingAxis = v;
+	}
+	return GJKResult::Touching;
+}
+
+struct EPAFace {
+	int		indices[3];
+	Vector3 normal;
+	float	distance;
+};
+
+static bool MakeFace(EPAFace& face, const SupportPoint* vertices, int a, int b, int c, const Vector3& centre) {
+	Vector3 normal = Vector3::Cross(vertices[b].pos - vertices[a].pos, vertices[c].pos - vertices[a].pos);
+	float length = normal.Length();
+	if (length < 1e-12f) {
+		return false;
+	}
+	normal = normal / length;
+	//Faces always point away from the middle of the polytope
+	if (Vector3::Dot(normal, vertices[a].pos - centre) < 0.0f) {
+		normal = -normal;
+		int temp = b; b = c; c = temp;
+	}
+	face.indices[0] = a;
+	face.indices[1] = b;
+	face.indices[2] = c;
+	face.normal		= normal;
+	face.distance	= Vector3::Dot(normal, vertices[a].pos);
+	return true;
+}
+
+/*
+EPA needs a full tetrahedron to start from, but GJK can stop with fewer
+points if the origin was on an edge or face of the simplex. More points are
+found by searching out in directions the simplex doesn't cover yet.
+*/
+static bool BuildTetrahedron(const ConvexShape& a, const ConvexShape& b, SupportPoint* simplex, int& size) {
+	static const Vector3 axes[6] = {
+		Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0),
+		Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)
+	};
+	if (size == 0) {
+		simplex[size++] = Support(a, b, axes[0]);
+	}
+	if (size == 1) {
+		for (int i = 0; i < 6 && size == 1; ++i) {
+			SupportPoint p = Support(a, b, axes[i]);
+			if ((p.pos - simplex[0].pos).LengthSquared() > gjkTolerance) {
+				simplex[size++] = p;
+			}
+		}
+	}
+	if (size == 2) {
+		Vector3 line = simplex[1].pos - simplex[0].pos;
+		for (int i = 0; i < 6 && size == 2; ++i) {
+			Vector3 dir = Vector3::Cross(line, axes[i]);
+			if (dir.LengthSquared() < gjkTolerance) {
+				continue;
+			}
+			SupportPoint p = Support(a, b, dir);
+			if (Vector3::Cross(p.pos - simplex[0].pos, line).LengthSquared() > gjkTolerance) {
+				simplex[size++] = p;
+			}
+		}
+	}
+	if (size == 3) {
+		Vector3 normal = Vector3::Cross(simplex[1].pos - simplex[0].pos, simplex[2].pos - simplex[0].pos);
+		SupportPoint p = Support(a, b, normal);
+		if (fabs(Vector3::Dot(p.pos - simplex[0].pos, normal)) < gjkTolerance) {
+			p = Support(a, b, -normal);
+		}
+		if (fabs(Vector3::Dot(p.pos - simplex[0].pos, normal)) >= gjkTolerance) {
+			simplex[size++] = p;
+		}
+	}
+	return size == 4;
+}
+
+static bool RunEPA(const ConvexShape& a, const ConvexShape& b, SupportPoint* simplex, int size,
+	Vector3& normal, float& depth, Vector3& onA, Vector3& onB) {
+	if (!BuildTetrahedron(a, b, simplex, size)) {
+		return false; //flat shapes, with nothing to push out along
+	}
+	SupportPoint	vertices[maxEPAVertices];
+	EPAFace			faces[maxEPAFaces];
+	int				vertexCount = 4;
+	int				faceCount	= 0;
+
+	Vector3 centre;
+	for (int i = 0; i < 4; ++i) {
+		vertices[i] = simplex[i];
+		centre += simplex[i].pos * 0.25f;
+	}
+	static const int start[4][3] = { {0, 1, 2}, {0, 3, 1}, {0, 2, 3}, {1, 3, 2} };
+	for (int i = 0; i < 4; ++i) {
+		if (MakeFace(faces[faceCount], vertices, start[i][0], start[i][1], start[i][2], centre)) {
+			faceCount++;
+		}
+	}
+
+	for (int iteration = 0; iteration < maxEPAIterations && faceCount > 0; ++iteration) {
+		int closest = 0;
+		for (int i = 1; i < faceCount; ++i) {
+			if (faces[i].distance < faces[closest].distance) {
+				closest = i;
+			}
+		}
+		SupportPoint p = Support(a, b, faces[closest].normal);
+		if (Vector3::Dot(p.pos, faces[closest].normal) - faces[closest].distance < epaTolerance || vertexCount == maxEPAVertices) {
+			break; //the closest face is on the surface of the difference
+		}
+		int newVertex = vertexCount;
+		vertices[vertexCount++] = p;
+
+		//Every face the new point can see is removed, leaving a hole whose
+		//rim is made of the edges that only one removed face had
+		int edges[maxEPAFaces * 3][2];
+		int edgeCount = 0;
+		for (int i = 0; i < faceCount; ) {
+			if (Vector3::Dot(faces[i].normal, p.pos - vertices[faces[i].indices[0]].pos) <= 0.0f) {
+				++i;
+				continue;
+			}
+			for (int e = 0; e < 3; ++e) {
+				int from	= faces[i].indices[e];
+				int to		= faces[i].indices[(e + 1) % 3];
+				bool shared = false;
+				for (int k = 0; k < edgeCount; ++k) {
+					if (edges[k][0] == to && edges[k][1] == from) {
+						edges[k][0] = edges[edgeCount - 1][0];
+						edges[k][1] = edges[edgeCount - 1][1];
+						edgeCount--;
+						shared = true;
+						break;
+					}
+				}
+				if (!shared) {
+					edges[edgeCount][0] = from;
+					edges[edgeCount][1] = to;
+					edgeCount++;
+				}
+			}
+			faces[i] = faces[--faceCount];
+		}
+		for (int k = 0; k < edgeCount && faceCount < maxEPAFaces; ++k) {
+			if (MakeFace(faces[faceCount], vertices, edges[k][0], edges[k][1], newVertex, centre)) {
+				faceCount++;
+			}
+		}
+	}
+	if (faceCount == 0) {
+		return false;
+	}
+	//Found again, as running out of iterations leaves the polytope changed since the last search
+	int closest = 0;
+	for (int i = 1; i < faceCount; ++i) {
+		if (faces[i].distance < faces[closest].distance) {
+			closest = i;
+		}
+	}
+	const EPAFace& face = faces[closest];
+	normal	= face.normal;
+	depth	= face.distance;
+
+	//Where the origin lands on the face gives how much of each corner to take
+	SupportPoint tri[3] = { vertices[face.indices[0]], vertices[face.indices[1]], vertices[face.indices[2]] };
+	Vector3 p	= normal * depth;
+	Vector3 v0	= tri[1].pos - tri[0].pos;
+	Vector3 v1	= tri[2].pos - tri[0].pos;
+	Vector3 v2	= p - tri[0].pos;
+	float d00 = Vector3::Dot(v0, v0);
+	float d01 = Vector3::Dot(v0, v1);
+	float d11 = Vector3::Dot(v1, v1);
+	float d20 = Vector3::Dot(v2, v0);
+	float d21 = Vector3::Dot(v2, v1);
+	float denom = d00 * d11 - d01 * d01;
+
+	float u = 0.0f;
+	float v = 0.0f;
+	if (fabs(denom) > 1e-12f) {
+		u = (d11 * d20 - d01 * d21) / denom;
+		v = (d00 * d21 - d01 * d20) / denom;
+	}
+	float w = 1.0f - u - v;
+
+	onA = tri[0].onA * w + tri[1].onA * u + tri[2].onA * v;
+	onB = tri[0].onB * w + tri[1].onB * u + tri[2].onB * v;
+	return true;
+}
+
+GJKAlgorithm::GJKAlgorithm()	{
+}
+
+GJKAlgorithm::~GJKAlgorithm()	{
+}
+
+//Anything with a support function can go through here, so new convex shapes just need adding to ConvexShape
+bool GJKAlgorithm::IsConvex(VolumeType type) {
+	return type == VolumeType::AABB || type == VolumeType::OBB || type == VolumeType::Sphere;
+}
+
+static bool ShapeIntersection(const ConvexShape& a, const ConvexShape& b, CollisionDetection::CollisionInfo& collisionInfo, Vector3* separatingAxis) {
+	SupportPoint	simplex[4];
+	float			weights[4];
+	int				size;
+	Vector3			v;
+
+	GJKResult result = RunGJK(a, b, simplex, weights, size, v, separatingAxis);
+	if (result == GJKResult::Separated) {
+		return false;
+	}
+
+	Vector3 normal;
+	float	penetration;
+	Vector3 onA;
+	Vector3 onB;
+
+	if (result == GJKResult::Touching) {
+		float distance = v.Length();
+		if (distance >= a.margin + b.margin || distance == 0.0f) {
+			return false;
+		}
+		//v points from B's closest point to A's, so the normal from A to B is the other way
+		normal		= -v / distance;
+		penetration = a.margin + b.margin - distance;
+		for (int i = 0; i < size; ++i) {
+			onA += simplex[i].onA * weights[i];
+			onB += simplex[i].onB * weights[i];
+		}
+	}
+	else {
+		float depth;
+		if (!RunEPA(a, b, simplex, size, normal, depth, onA, onB)) {
+			return false;
+		}
+		penetration = depth + a.margin + b.margin;
+	}
+	onA = onA + normal * a.margin;
+	onB = onB - normal * b.margin;
+
+	collisionInfo.AddContactPoint(onA - a.position, onB - b.position, normal, penetration);
+	return true;
+}
+
+bool GJKAlgorithm::Intersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB,
+	CollisionDetection::CollisionInfo& collisionInfo, Vector3* separatingAxis) {
+	return ShapeIntersection(ConvexShape(volumeA, worldTransformA), ConvexShape(volumeB, worldTransformB), collisionInfo, separatingAxis);
+}
+
+bool GJKAlgorithm::TriangleIntersection(const Vector3* triangle, const Vector3& origin,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, CollisionDetection::CollisionInfo& collisionInfo) {
+	return ShapeIntersection(ConvexShape(triangle, origin), ConvexShape(volumeB, worldTransformB), collisionInfo, nullptr);
+}
+
+float GJKAlgorithm::Distance(const CollisionVolume& volumeA, const Transform& worldTransformA,
+	const CollisionVolume& volumeB, const Transform& worldTransformB, Vector3& onA, Vector3& onB) {
+	ConvexShape a(volumeA, worldTransformA);
+	ConvexShape b(volumeB, worldTransformB);
+
+	SupportPoint	simplex[4];
+	float			weights[4];
+	int				size;
+	Vector3			v;
+
+	//Rather than stopping as soon as there's a gap, GJK runs all the way down to the closest points
+	if (RunGJK(a, b, simplex, weights, size, v, nullptr, false) == GJKResult::Overlapping) {
+		onA = a.position;
+		onB = b.position;
+		return 0.0f;
+	}
+	onA = Vector3();
+	onB = Vector3();
+	for (int i = 0; i < size; ++i) {
+		onA += simplex[i].onA * weights[i];
+		onB += simplex[i].onB * weights[i];
+	}
+	float distance = v.Length();
+	if (distance > 0.0f) {
+		onA = onA - v * (a.margin / distance);
+		onB = onB + v * (b.margin / distance);
+	}
+	float gap = distance - a.margin - b.margin;
+	return gap > 0.0f ? gap : 0.0f;
+}
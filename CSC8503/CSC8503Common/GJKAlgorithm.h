@@ -0,0 +1,56 @@
+#pragma once
+#include "CollisionDetection.h"
+#include "Simplex.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		class Transform;
+
+		/*
+		Collision between any two convex volumes, using nothing but their
+		support functions - the point furthest along a given direction.
+
+		GJK walks a simplex through the Minkowski difference of the two shapes
+		towards the origin, which gives the distance between them, or shows
+		that they overlap. If they overlap, EPA then grows the simplex out into
+		a polytope until it finds the face of the difference that is closest
+		to the origin, which gives the penetration depth and normal.
+
+		Spheres are handled as a point with a margin round it, so that only
+		the margin needs adding on at the end, rather than EPA having to chip
+		away at a curved surface.
+
+		If given somewhere to keep it, the direction GJK last separated a pair
+		along is tried first the next time round. Objects that were apart last
+		step usually still are, so most pairs only need a single support point
+		to rule out.
+		*/
+		class GJKAlgorithm	{
+		public:
+			static bool IsConvex(VolumeType type);
+
+			static bool Intersection(const CollisionVolume& volumeA, const Transform& worldTransformA,
+				const CollisionVolume& volumeB, const Transform& worldTransformB,
+				CollisionDetection::CollisionInfo& collisionInfo, Vector3* separatingAxis = nullptr);
+
+			/*
+			A single world space triangle, as A, against a convex volume. The
+			triangle's contact points come out relative to origin, which is
+			meant to be the centre of the mesh the triangle came from. B can't
+			be a sphere, as with no thickness on either side EPA has nothing
+			to work with once the sphere's centre is through the triangle.
+			*/
+			static bool TriangleIntersection(const Vector3* triangle, const Vector3& origin,
+				const CollisionVolume& volumeB, const Transform& worldTransformB,
+				CollisionDetection::CollisionInfo& collisionInfo);
+
+			//The gap between the two surfaces, or 0 if they overlap, along with the closest points on each
+			static float Distance(const CollisionVolume& volumeA, const Transform& worldTransformA,
+				const CollisionVolume& volumeB, const Transform& worldTransformB, Vector3& onA, Vector3& onB);
+
+		private:
+			GJKAlgorithm();
+			~GJKAlgorithm();
+		};
+	}
+}
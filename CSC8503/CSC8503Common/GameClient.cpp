@@ -1,4 +1,6 @@
 #include "GameClient.h"
+#include <enet/enet.h>
+#include "Profiler.h"
 #include <iostream>
 #include <string>
 
@@ -32,6 +34,7 @@ bool GameClient::Connect(uint8_t a, uint8_t b, uint8_t c, uint8_t d, int portNum
 }
 
 void GameClient::UpdateClient() {
+	PROFILE_ZONE("GameClient::UpdateClient");
 	if (netHandle == nullptr)
 	{
 		return;
@@ -1,15 +1,24 @@
 #include "GameObject.h"
 #include "CollisionDetection.h"
+#include "CompoundVolume.h"
+#include "NetworkObject.h"
 
 using namespace NCL::CSC8503;
 
 GameObject::GameObject(string objectName)	{
 	name			= objectName;
 	isActive		= true;
+	worldID			= -1;
+	partitionIndex	= -1;
 	boundingVolume	= nullptr;
 	physicsObject	= nullptr;
 	renderObject	= nullptr;
 	networkObject	= nullptr;
+	broadphaseProxy	= -1;
+	staticProxy		= -1;
+	isStatic		= false;
+	collisionLayer	= 0;
+	isTrigger		= false;
 	CollisionPos	= objectName;
 }
 
@@ -51,4 +60,9 @@ void GameObject::UpdateBroadphaseAABB() {
 		Vector3 halfSizes = ((OBBVolume&)*boundingVolume).GetHalfDimensions();
 		broadphaseAABB = mat * halfSizes;
 	}
+	else if (boundingVolume->type == VolumeType::Mesh || boundingVolume->type == VolumeType::Compound) {
+		Matrix3 mat = Matrix3(transform.GetWorldOrientation());
+		mat = mat.Absolute();
+		broadphaseAABB = mat * CompoundVolume::GetVolumeHalfSize(*boundingVolume);
+	}
 }
\ No newline at end of file
@@ -4,7 +4,8 @@
 
 #include "PhysicsObject.h"
 #include "RenderObject.h"
-#include "NetworkObject.h"
+#include "SlotMap.h"
+#include "BlockPool.h"
 
 #include <vector>
 
@@ -14,10 +15,12 @@ namespace NCL {
 	namespace CSC8503 {
 		class NetworkObject;
 
-		class GameObject	{
+		typedef SlotHandle GameObjectHandle;
+
+		class GameObject : public PooledAllocation<GameObject>	{
 		public:
 			GameObject(string name = "");
-			~GameObject();
+			virtual ~GameObject();
 
 			//int isWall = 0;
 
@@ -83,6 +86,82 @@ namespace NCL {
 
 			void UpdateBroadphaseAABB();
 
+			int GetBroadphaseProxy() const {
+				return broadphaseProxy;
+			}
+
+			void SetBroadphaseProxy(int proxy) {
+				broadphaseProxy = proxy;
+			}
+
+			//Static objects are never moved by the physics system, and are kept
+			//out of its broadphase, in the world's static object index instead
+			bool IsStatic() const {
+				return isStatic;
+			}
+
+			void SetStatic(bool state) {
+				isStatic = state;
+			}
+
+			int GetStaticProxy() const {
+				return staticProxy;
+			}
+
+			void SetStaticProxy(int proxy) {
+				staticProxy = proxy;
+			}
+
+			//Which of the 32 collision layers the object is on, so that queries
+			//can pick out just the kinds of object they're interested in
+			void SetCollisionLayer(int layer) {
+				collisionLayer = layer;
+			}
+
+			int GetCollisionLayer() const {
+				return collisionLayer;
+			}
+
+			unsigned int GetCollisionLayerMask() const {
+				return 1u << collisionLayer;
+			}
+
+			//Triggers report what they overlap like anything else, but are never
+			//pushed apart from it, or used to stop anything passing through
+			void SetTrigger(bool state) {
+				isTrigger = state;
+			}
+
+			bool IsTrigger() const {
+				return isTrigger;
+			}
+
+			void SetWorldID(int newID) {
+				worldID = newID;
+			}
+
+			int GetWorldID() const {
+				return worldID;
+			}
+
+			//Given out by the world as the object is added, and stale once it is removed
+			void SetHandle(GameObjectHandle h) {
+				handle = h;
+			}
+
+			GameObjectHandle GetHandle() const {
+				return handle;
+			}
+
+			//Where the world is keeping the object in its dynamic or loose object list
+			void SetPartitionIndex(int index) {
+				partitionIndex = index;
+			}
+
+			int GetPartitionIndex() const {
+				return partitionIndex;
+			}
+
 			void SetCollisionPos(Vector3& pos) {
 				collidedAt = pos;
 			}
@@ -97,9 +176,17 @@ namespace NCL {
 			NetworkObject*		networkObject;
 
 			bool	isActive;
+			int		worldID;
+			GameObjectHandle handle;
+			int		partitionIndex;
 			string	name;
 
 			Vector3 broadphaseAABB;
+			int		broadphaseProxy;
+			int		staticProxy;
+			bool	isStatic;
+			int		collisionLayer;
+			bool	isTrigger;
 
 			//鼠标点击位置
 			Vector3		collidedAt;
@@ -1,5 +1,7 @@
 #include "GameServer.h"
+#include <enet/enet.h>
 #include "GameWorld.h"
+#include "Profiler.h"
 #include <iostream>
 
 using namespace NCL;
@@ -60,6 +62,7 @@ bool GameServer::SendGlobalPacket(GamePacket& packet) {
 }
 
 void GameServer::UpdateServer() {
+	PROFILE_ZONE("GameServer::UpdateServer");
 	if (!netHandle) {
 		return;
 	}
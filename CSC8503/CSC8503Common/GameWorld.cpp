@@ -2,45 +2,229 @@
 #include "GameObject.h"
 #include "Constraint.h"
 #include "CollisionDetection.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 #include "../../Common/Camera.h"
 #include <algorithm>
 
 using namespace NCL;
 using namespace NCL::CSC8503;
 
-GameWorld::GameWorld()	{
+GameWorld::GameWorld() : staticTree(0.0f)	{
 	mainCamera = new Camera();
 
 	quadTree = nullptr;
 
 	shuffleConstraints	= false;
 	shuffleObjects		= false;
+	worldIDCounter		= 0;
+
+	transformOrderDirty = false;
 }
 
 GameWorld::~GameWorld()	{
 }
 
 void GameWorld::Clear() {
-	gameObjects.clear();
+	for (auto& i : gameObjects) {
+		if (objectRemovedFunc) {
+			objectRemovedFunc(i);
+		}
+		i->SetStaticProxy(-1);
+		i->SetPartitionIndex(-1);
+		i->SetHandle(GameObjectHandle());
+		i->GetTransform().SetOrderIndex(-1);
+	}
+	if (objectsRemovedFunc) {
+		objectsRemovedFunc();
+	}
+	//Whatever was waiting to be destroyed was on its way out anyway
+	for (GameObject* o : destroyedObjects) {
+		delete o;
+	}
+	gameObjects.Clear();
+	destroyedObjects.clear();
+	dynamicObjects.clear();
+	looseObjects.clear();
+	staticTree.Clear();
 	constraints.clear();
+	transformOrder.clear();
+	transformOrderDirty = false;
 }
 
 void GameWorld::ClearAndErase() {
+	for (auto& i : gameObjects) {
+		if (objectRemovedFunc) {
+			objectRemovedFunc(i);
+		}
+	}
+	if (objectsRemovedFunc) {
+		objectsRemovedFunc();
+	}
 	for (auto& i : gameObjects) {
 		delete i;
 	}
 	for (auto& i : constraints) {
 		delete i;
 	}
-	Clear();
+	gameObjects.Clear();
+	destroyedObjects.clear();
+	dynamicObjects.clear();
+	looseObjects.clear();
+	staticTree.Clear();
+	constraints.clear();
+	transformOrder.clear();
+	transformOrderDirty = false;
 }
 
-void GameWorld::AddGameObject(GameObject* o) {
-	gameObjects.emplace_back(o);
+GameObjectHandle GameWorld::AddGameObject(GameObject* o) {
+	o->SetHandle(gameObjects.Insert(o));
+	o->SetWorldID(worldIDCounter++);
+	AddToPartition(o);
+
+	//Anything without children can go on the end, as its parent (if it has
+	//one in this world) is already further up - anything else needs a sort
+	Transform& t = o->GetTransform();
+	if (t.HasChildren()) {
+		transformOrderDirty = true;
+	}
+	t.SetOrderIndex((int)transformOrder.size());
+	transformOrder.emplace_back(&t);
+
+	if (objectAddedFunc) {
+		objectAddedFunc(o);
+	}
+	return o->GetHandle();
 }
 
+/*
+The last object in the list is moved into the removed object's place, so
+removing is the same cost however many objects there are, but does change
+the order the rest are iterated over in.
+*/
 void GameWorld::RemoveGameObject(GameObject* o) {
-	std::remove(gameObjects.begin(), gameObjects.end(), o);
+	DetachGameObject(o);
+	if (objectsRemovedFunc) {
+		objectsRemovedFunc();
+	}
+}
+
+void GameWorld::DetachGameObject(GameObject* o) {
+	GameObject* const* stored = gameObjects.Get(o->GetHandle());
+	if (!stored || *stored != o) {
+		return;
+	}
+	if (objectRemovedFunc) {
+		objectRemovedFunc(o);
+	}
+	RemoveFromPartition(o);
+	gameObjects.Remove(o->GetHandle());
+	o->SetHandle(GameObjectHandle());
+
+	//The gap is closed up on the next UpdateTransforms, keeping everything else in order
+	Transform& t = o->GetTransform();
+	if (IsInTransformOrder(&t)) {
+		transformOrder[t.GetOrderIndex()] = nullptr;
+	}
+	t.SetOrderIndex(-1);
+}
+
+void GameWorld::DestroyGameObject(GameObject* o) {
+	if (!o || !gameObjects.Contains(o->GetHandle())) {
+		return;
+	}
+	if (std::find(destroyedObjects.begin(), destroyedObjects.end(), o) == destroyedObjects.end()) {
+		destroyedObjects.emplace_back(o);
+	}
+}
+
+void GameWorld::DestroyGameObject(GameObjectHandle h) {
+	GameObject* const* stored = gameObjects.Get(h);
+	if (stored) {
+		DestroyGameObject(*stored);
+	}
+}
+
+//Everything is removed before anything is deleted, so the whole batch is tidied up after at once
+void GameWorld::DestroyPendingObjects() {
+	if (destroyedObjects.empty()) {
+		return;
+	}
+	for (GameObject* o : destroyedObjects) {
+		DetachGameObject(o);
+	}
+	if (objectsRemovedFunc) {
+		objectsRemovedFunc();
+	}
+	for (GameObject* o : destroyedObjects) {
+		delete o;
+	}
+	destroyedObjects.clear();
+}
+
+/*
+Anything with an infinite mass can never be moved by the physics system, so
+it goes into a tree of its own, built up as the level is loaded. Everything
+else that has a physics object goes into the dynamic list, which is all the
+physics system needs to integrate and test against everything else.
+*/
+void GameWorld::AddToPartition(GameObject* o) {
+	PhysicsObject* physics = o->GetPhysicsObject();
+	if (!physics) {
+		o->SetStatic(false);
+		if (o->GetBoundingVolume()) {
+			o->SetPartitionIndex((int)looseObjects.size());
+			looseObjects.emplace_back(o);
+		}
+		return;
+	}
+	if (physics->GetInverseMass() != 0.0f) {
+		o->SetStatic(false);
+		o->SetPartitionIndex((int)dynamicObjects.size());
+		dynamicObjects.emplace_back(o);
+		return;
+	}
+	o->SetStatic(true);
+	if (!o->GetBoundingVolume()) {
+		return;
+	}
+	o->UpdateBroadphaseAABB();
+
+	Vector3 halfSizes;
+	o->GetBroadphaseAABB(halfSizes);
+	o->SetStaticProxy(staticTree.InsertProxy(o, o->GetConstTransform().GetWorldPosition(), halfSizes));
+}
+
+void GameWorld::RemoveFromPartition(GameObject* o) {
+	if (o->GetStaticProxy() != -1) {
+		staticTree.RemoveProxy(o->GetStaticProxy());
+		o->SetStaticProxy(-1);
+		return;
+	}
+	int index = o->GetPartitionIndex();
+	if (index == -1) {
+		return;
+	}
+	//The object's physics object may have come or gone since it was added
+	bool dynamic = index < (int)dynamicObjects.size() && dynamicObjects[index] == o;
+	std::vector<GameObject*>& list = dynamic ? dynamicObjects : looseObjects;
+
+	list[index] = list.back();
+	list[index]->SetPartitionIndex(index);
+	list.pop_back();
+	o->SetPartitionIndex(-1);
+}
+
+void GameWorld::UpdateStaticObject(GameObject* o) {
+	int proxy = o->GetStaticProxy();
+	if (proxy == -1) {
+		return;
+	}
+	o->UpdateBroadphaseAABB();
+
+	Vector3 halfSizes;
+	o->GetBroadphaseAABB(halfSizes);
+	staticTree.MoveProxy(proxy, o->GetConstTransform().GetWorldPosition(), halfSizes, Vector3());
 }
 
 void GameWorld::GetObjectIterators(
@@ -51,6 +235,14 @@ void GameWorld::GetObjectIterators(
 	last	= gameObjects.end();
 }
 
+void GameWorld::GetDynamicObjectIterators(
+	GameObjectIterator& first,
+	GameObjectIterator& last) const {
+
+	first	= dynamicObjects.begin();
+	last	= dynamicObjects.end();
+}
+
 void GameWorld::OperateOnContents(GameObjectFunc f) {
 	for (GameObject* g : gameObjects) {
 		f(g);
@@ -58,10 +250,18 @@ void GameWorld::OperateOnContents(GameObjectFunc f) {
 }
 
 void GameWorld::UpdateWorld(float dt) {
+	PROFILE_ZONE("GameWorld::UpdateWorld");
+	DestroyPendingObjects();
 	UpdateTransforms();
 
 	if (shuffleObjects) {
-		std::random_shuffle(gameObjects.begin(), gameObjects.end());
+		for (int i = gameObjects.GetCount() - 1; i > 0; --i) {
+			gameObjects.Swap(i, rand() % (i + 1));
+		}
+		std::random_shuffle(dynamicObjects.begin(), dynamicObjects.end());
+		for (int i = 0; i < (int)dynamicObjects.size(); ++i) {
+			dynamicObjects[i]->SetPartitionIndex(i);
+		}
 	}
 
 	if (shuffleConstraints) {
@@ -69,10 +269,74 @@ void GameWorld::UpdateWorld(float dt) {
 	}
 }
 
+/*
+Only transforms that have been changed since they were last updated (or
+whose parent has) are updated, so walls and other things that never move
+cost nothing after their first frame. Going through them parents first
+means a child is always built on its parent's new world matrix.
+
+The same pass closes up any gaps left by removed objects, and checks that
+every transform given a new parent still comes after it. Only if one
+doesn't is the order sorted again, after which anything updated too early
+is updated again - its parent's update will have marked it dirty.
+*/
 void GameWorld::UpdateTransforms() {
-	for (auto& i : gameObjects) {
-		i->GetTransform().UpdateMatrices();
+	if (transformOrderDirty) {
+		SortTransforms();
+	}
+	int out = 0;
+	for (Transform* t : transformOrder) {
+		if (!t) {
+			continue;
+		}
+		t->SetOrderIndex(out);
+		transformOrder[out++] = t;
+
+		if (t->HasParentChanged()) {
+			t->ClearParentChanged();
+			Transform* parent = t->GetParent();
+			//parents from outside of this world are just roots as far as its order goes
+			if (parent && IsInTransformOrder(parent) && parent->GetOrderIndex() >= t->GetOrderIndex()) {
+				transformOrderDirty = true;
+			}
+		}
+		if (t->IsDirty()) {
+			t->UpdateMatrices();
+		}
+	}
+	transformOrder.resize(out);
+
+	if (transformOrderDirty) {
+		SortTransforms();
+		for (Transform* t : transformOrder) {
+			if (t->IsDirty()) {
+				t->UpdateMatrices();
+			}
+		}
+	}
+}
+
+bool GameWorld::IsInTransformOrder(const Transform* t) const {
+	int index = t->GetOrderIndex();
+	return index >= 0 && index < (int)transformOrder.size() && transformOrder[index] == t;
+}
+
+//Only needed once parents and children have been added or linked out of order
+void GameWorld::SortTransforms() {
+	std::vector<std::pair<int, Transform*>> depths;
+	depths.reserve(gameObjects.GetCount());
+	for (GameObject* o : gameObjects) {
+		depths.emplace_back(o->GetTransform().GetDepth(), &o->GetTransform());
+	}
+	std::stable_sort(depths.begin(), depths.end(), [](const std::pair<int, Transform*>& a, const std::pair<int, Transform*>& b) {
+		return a.first < b.first;
+	});
+	transformOrder.clear();
+	for (auto& d : depths) {
+		d.second->SetOrderIndex((int)transformOrder.size());
+		transformOrder.emplace_back(d.second);
 	}
+	transformOrderDirty = false;
 }
 
 void GameWorld::UpdateQuadTree() {
@@ -85,36 +349,117 @@ void GameWorld::UpdateQuadTree() {
 	//}
 }
 
-bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObject) const {
-	//The simplest raycast just goes through each object and sees if there's a collision
-	RayCollision collision;
-	
-	for (auto& i : gameObjects) {
-		if (!i->GetBoundingVolume()) { //objects might not be collideable etc...
-			continue;
+bool GameWorld::Raycast(Ray& r, RayCollision& closestCollision, bool closestObject, float maxDistance, unsigned int layerMask) const {
+	RayQuery		query(r, layerMask, maxDistance, closestObject);
+	RayCollision	collision;
+
+	RefreshRaycastBounds();
+	RaycastPacket(&query, 1, &collision);
+
+	if (collision.node) {
+		closestCollision = collision;
+		return true;
+	}
+	return false;
+}
+
+void GameWorld::RaycastBatch(const std::vector<RayQuery>& queries, std::vector<RayCollision>& results, JobSystem* jobs) const {
+	int count = (int)queries.size();
+	results.assign(count, RayCollision());
+
+	RefreshRaycastBounds();
+
+	auto castRange = [&](int begin, int end, int) {
+		for (int first = begin; first < end; first += BroadphaseRayPacket::maxRays) {
+			int packetSize = end - first < BroadphaseRayPacket::maxRays ? end - first : BroadphaseRayPacket::maxRays;
+			RaycastPacket(&queries[first], packetSize, &results[first]);
 		}
+	};
+	if (jobs) {
+		jobs->ParallelFor(count, castRange, BroadphaseRayPacket::maxRays);
+	}
+	else {
+		castRange(0, count, 0);
+	}
+}
+
+/*
+Objects nothing keeps a tree of have their bounds tested one by one, so
+they're brought up to date once before any rays are cast, rather than by
+every ray (and maybe from several threads at once).
+*/
+void GameWorld::RefreshRaycastBounds() const {
+	if (dynamicRaycastPrepareFunc) {
+		dynamicRaycastPrepareFunc();
+	}
+	if (!dynamicRaycastFunc) {
+		for (GameObject* o : dynamicObjects) {
+			o->UpdateBroadphaseAABB();
+		}
+	}
+	for (GameObject* o : looseObjects) {
+		o->UpdateBroadphaseAABB();
+	}
+}
+
+void GameWorld::RaycastPacket(const RayQuery* queries, int count, RayCollision* results) const {
+	BroadphaseRayPacket packet;
+	packet.rayCount = count;
+	for (int i = 0; i < count; ++i) {
+		packet.SetRay(i, queries[i].ray.GetPosition(), queries[i].ray.GetDirection(), queries[i].maxDistance);
+	}
+	int raysLeft = count;
+
+	//By the time an object gets here the ray is known to pass through its box.
+	//Rays happy with any hit are finished with by giving them a negative length
+	RaycastVisitor visit = [&](GameObject* o, int ray, float& distance) {
+		const RayQuery& query = queries[ray];
 		RayCollision thisCollision;
-		if (CollisionDetection::RayIntersection(r, *i, thisCollision)) {
-				
-			if (!closestObject) {	
-				closestCollision		= collision;
-				closestCollision.node = i;
-				return true;
+		if (!(o->GetCollisionLayerMask() & query.layerMask) || !o->GetBoundingVolume() ||
+			!CollisionDetection::RayIntersection(query.ray, *o, thisCollision) || thisCollision.rayDistance > distance) {
+			return true;
+		}
+		thisCollision.node	= o;
+		results[ray]		= thisCollision;
+		distance			= thisCollision.rayDistance;
+		if (!query.closestObject) {
+			packet.maxDistances[ray] = -1.0f;
+			raysLeft--;
+			return false;
+		}
+		packet.maxDistances[ray] = distance;
+		return true;
+	};
+
+	auto visitAll = [&](const std::vector<GameObject*>& objects) {
+		for (GameObject* o : objects) {
+			Vector3 halfSizes;
+			if (!o->GetBroadphaseAABB(halfSizes)) {
+				continue;
 			}
-			else {
-				if (thisCollision.rayDistance < collision.rayDistance) {
-					thisCollision.node = i;
-					collision = thisCollision;
+			unsigned int hitRays = packet.RayTest(BroadphaseBounds(o->GetConstTransform().GetWorldPosition(), halfSizes));
+			for (int i = 0; hitRays != 0; ++i, hitRays >>= 1) {
+				if (hitRays & 1) {
+					visit(o, i, packet.maxDistances[i]);
 				}
 			}
 		}
+	};
+
+	staticTree.RayCastPacket(packet, [&](int proxy, int ray, float& distance) {
+		return visit(staticTree.GetObject(proxy), ray, distance);
+	});
+	if (raysLeft > 0) {
+		if (dynamicRaycastFunc) {
+			dynamicRaycastFunc(packet, visit);
+		}
+		else {
+			visitAll(dynamicObjects);
+		}
 	}
-	if (collision.node) {
-		closestCollision		= collision;
-		closestCollision.node	= collision.node;
-		return true;
+	if (raysLeft > 0) {
+		visitAll(looseObjects);
 	}
-	return false;
 }
 
 
@@ -127,7 +472,7 @@ void GameWorld::AddConstraint(Constraint* c) {
 }
 
 void GameWorld::RemoveConstraint(Constraint* c) {
-	std::remove(constraints.begin(), constraints.end(), c);
+	constraints.erase(std::remove(constraints.begin(), constraints.end(), c), constraints.end());
 }
 
 void GameWorld::GetConstraintIterators(
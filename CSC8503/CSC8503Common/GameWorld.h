@@ -1,8 +1,11 @@
 #pragma once
+#include <cfloat>
 #include <vector>
 #include "Ray.h"
 #include "CollisionDetection.h"
 #include "QuadTree.h"
+#include "DynamicAABBTree.h"
+#include "SlotMap.h"
 namespace NCL {
 		class Camera;
 		using Maths::Ray;
@@ -11,8 +14,34 @@ namespace NCL {
 		class Constraint;
 
 		typedef std::function<void(GameObject*)> GameObjectFunc;
+		typedef std::function<void()> ObjectsRemovedFunc;
 		typedef std::vector<GameObject*>::const_iterator GameObjectIterator;
 
+		/*
+		A ray for GameWorld::RaycastBatch, along with the layers it can hit
+		(as a mask of GameObject::GetCollisionLayerMask bits), how far it goes,
+		and whether it wants the closest hit, or is happy with any.
+		*/
+		struct RayQuery {
+			RayQuery(const Ray& r, unsigned int layers = ~0u, float distance = FLT_MAX, bool closest = true) : ray(r) {
+				layerMask		= layers;
+				maxDistance		= distance;
+				closestObject	= closest;
+			}
+			Ray				ray;
+			unsigned int	layerMask;
+			float			maxDistance;
+			bool			closestObject;
+		};
+
+		//Called for each object a ray in a packet reaches, along with how far that ray goes.
+		//Shortening the ray skips anything further away, and returning false drops the ray
+		typedef std::function<bool(GameObject*, int ray, float&)> RaycastVisitor;
+		typedef std::function<void(const BroadphaseRayPacket&, const RaycastVisitor&)> RaycastFunc;
+		typedef std::function<void()> RaycastPrepareFunc;
+
+		class JobSystem;
+
 		class GameWorld	{
 		public:
 			GameWorld();
@@ -21,9 +50,33 @@ namespace NCL {
 			void Clear();
 			void ClearAndErase();
 
-			void AddGameObject(GameObject* o);
+			GameObjectHandle AddGameObject(GameObject* o);
+
+			//Takes the object out of the world straight away, without deleting it
 			void RemoveGameObject(GameObject* o);
 
+			/*
+			Queues the object to be removed from the world and deleted once the
+			frame is over, so anything still holding it (or iterating over the
+			world) this frame is left with something valid. Handles to it go
+			stale as it's removed.
+			*/
+			void DestroyGameObject(GameObject* o);
+			void DestroyGameObject(GameObjectHandle h);
+
+			//Removes and deletes everything queued by DestroyGameObject - UpdateWorld starts with this
+			void DestroyPendingObjects();
+
+			//nullptr if the object has since been removed from the world
+			GameObject* GetGameObject(GameObjectHandle h) const {
+				GameObject* const* o = gameObjects.Get(h);
+				return o ? *o : nullptr;
+			}
+
+			int GetGameObjectCount() const {
+				return gameObjects.GetCount();
+			}
+
 			void AddConstraint(Constraint* c);
 			void RemoveConstraint(Constraint* c);
 
@@ -39,7 +92,68 @@ namespace NCL {
 				shuffleObjects = state;
 			}
 
-			bool Raycast(Ray& r, RayCollision& closestCollision, bool closestObject = false) const;
+			/*
+			Finds an object on one of the layers in layerMask that the ray hits
+			within maxDistance - the closest one if closestObject is set, or else
+			the first one found. Static objects are found through the static tree,
+			and moving ones through the physics broadphase if it has set a raycast
+			func, so only objects whose boxes the ray passes through have their
+			real shape tested.
+			*/
+			bool Raycast(Ray& r, RayCollision& closestCollision, bool closestObject = false, float maxDistance = FLT_MAX, unsigned int layerMask = ~0u) const;
+
+			/*
+			Casts a whole batch of rays at once, leaving each one's hit (or an
+			empty collision) at the same place in results. Rays are walked
+			through the trees in packets, and if a job system is given the
+			packets are split up between its workers.
+			*/
+			void RaycastBatch(const std::vector<RayQuery>& queries, std::vector<RayCollision>& results, JobSystem* jobs = nullptr) const;
+
+			//Lets a system (such as the physics broadphase) track objects as they come and go
+			void SetObjectAddedFunc(GameObjectFunc f) {
+				objectAddedFunc = f;
+			}
+
+			void SetObjectRemovedFunc(GameObjectFunc f) {
+				objectRemovedFunc = f;
+			}
+
+			//Called once a batch of objects has been removed, before any of them
+			//are deleted, so whatever was tracking them can tidy up all at once
+			void SetObjectsRemovedFunc(ObjectsRemovedFunc f) {
+				objectsRemovedFunc = f;
+			}
+
+			//Lets the physics broadphase walk rays through the dynamic objects,
+			//rather than the world checking each one's bounds in turn. The prepare
+			//func is called before any rays are cast, to bring the broadphase up
+			//to date with objects moved since it last was
+			void SetDynamicRaycastFunc(RaycastFunc f, RaycastPrepareFunc prepare = nullptr) {
+				dynamicRaycastFunc			= f;
+				dynamicRaycastPrepareFunc	= prepare;
+			}
+
+			//Static objects don't move by themselves, so if game code moves one
+			//it must call this to keep the static object index up to date
+			void UpdateStaticObject(GameObject* o);
+
+			/*
+			Calls func(object) for every static object whose bounds overlap the
+			given box. Only the physics system's dynamic objects need this - static
+			objects are never tested against each other.
+			*/
+			template<class F>
+			void QueryStaticObjects(const BroadphaseBounds& bounds, F func) const {
+				staticTree.Query(bounds, [&](int proxy) {
+					func(staticTree.GetObject(proxy));
+					return true;
+				});
+			}
+
+			int GetStaticObjectCount() const {
+				return staticTree.GetProxyCount();
+			}
 
 			virtual void UpdateWorld(float dt);
 
@@ -49,15 +163,37 @@ namespace NCL {
 				GameObjectIterator& first,
 				GameObjectIterator& last) const;
 
+			//Only the objects the physics system should move
+			void GetDynamicObjectIterators(
+				GameObjectIterator& first,
+				GameObjectIterator& last) const;
+
 			void GetConstraintIterators(
 				std::vector<Constraint*>::const_iterator& first,
 				std::vector<Constraint*>::const_iterator& last) const;
 
 		protected:
 			void UpdateTransforms();
+			void SortTransforms();
+			bool IsInTransformOrder(const Transform* t) const;
 			void UpdateQuadTree();
 
-			std::vector<GameObject*> gameObjects;
+			void RefreshRaycastBounds() const;
+			void RaycastPacket(const RayQuery* queries, int count, RayCollision* results) const;
+
+			void DetachGameObject(GameObject* o);
+			void AddToPartition(GameObject* o);
+			void RemoveFromPartition(GameObject* o);
+
+			SlotMap<GameObject*>	 gameObjects;
+			std::vector<GameObject*> destroyedObjects;	//waiting for the end of the frame
+			std::vector<GameObject*> dynamicObjects;
+			std::vector<GameObject*> looseObjects; //have a volume, but no physics object
+
+			std::vector<Transform*>	transformOrder;	//every object's transform, parents before children, with gaps left by removals
+			bool					transformOrderDirty;
+
+			DynamicAABBTree<GameObject*> staticTree;
 
 			std::vector<Constraint*> constraints;
 
@@ -67,6 +203,14 @@ namespace NCL {
 
 			bool shuffleConstraints;
 			bool shuffleObjects;
+
+			int worldIDCounter;
+
+			GameObjectFunc objectAddedFunc;
+			GameObjectFunc objectRemovedFunc;
+			ObjectsRemovedFunc objectsRemovedFunc;
+			RaycastFunc	dynamicRaycastFunc;
+			RaycastPrepareFunc dynamicRaycastPrepareFunc;
 		};
 	}
 }
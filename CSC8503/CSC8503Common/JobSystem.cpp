@@ -0,0 +1,129 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+JobSystem::JobSystem(int workerCount)	{
+	jobFunc		= nullptr;
+	jobCount	= 0;
+	jobRanges	= 0;
+	jobsPending = 0;
+	generation	= 0;
+	quit		= false;
+
+	this->workerCount = workerCount < 1 ? 1 : workerCount;
+	StartThreads();
+}
+
+JobSystem::~JobSystem()	{
+	StopThreads();
+}
+
+void JobSystem::SetWorkerCount(int count) {
+	count = count < 1 ? 1 : count;
+	if (count == workerCount) {
+		return;
+	}
+	StopThreads();
+	workerCount = count;
+	StartThreads();
+}
+
+void JobSystem::StartThreads() {
+	quit = false;
+	for (int i = 1; i < workerCount; ++i) {
+		threads.emplace_back(&JobSystem::WorkerThread, this, i, generation);
+	}
+}
+
+void JobSystem::StopThreads() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	startCondition.notify_all();
+	for (std::thread& t : threads) {
+		t.join();
+	}
+	threads.clear();
+}
+
+/*
+Splits the job into jobRanges pieces as evenly as possible - the first
+(jobCount % jobRanges) ranges get one extra item each.
+*/
+void JobSystem::GetRange(int worker, int& begin, int& end) const {
+	int size	= jobCount / jobRanges;
+	int extra	= jobCount % jobRanges;
+
+	begin	= worker * size + (worker < extra ? worker : extra);
+	end		= begin + size + (worker < extra ? 1 : 0);
+}
+
+void JobSystem::ParallelFor(int count, const RangeFunc& func, int minRangeSize) {
+	if (count <= 0) {
+		return;
+	}
+	minRangeSize = minRangeSize < 1 ? 1 : minRangeSize;
+
+	int ranges = count / minRangeSize;
+	ranges = ranges > workerCount ? workerCount : ranges;
+
+	if (ranges <= 1) {
+		func(0, count, 0);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobFunc		= &func;
+		jobCount	= count;
+		jobRanges	= ranges;
+		jobsPending = ranges - 1;
+		generation++;
+	}
+	startCondition.notify_all();
+
+	int begin, end;
+	GetRange(0, begin, end);
+	{
+		PROFILE_ZONE("JobSystem::Range");
+		func(begin, end, 0);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [&] { return jobsPending == 0; });
+	jobFunc = nullptr;
+}
+
+void JobSystem::WorkerThread(int worker, int seenGeneration) {
+	PROFILE_THREAD("Worker " + std::to_string(worker));
+
+	while (true) {
+		const RangeFunc* func = nullptr;
+		int begin = 0;
+		int end	  = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			startCondition.wait(lock, [&] { return quit || generation != seenGeneration; });
+			if (quit) {
+				return;
+			}
+			seenGeneration = generation;
+			if (worker >= jobRanges) {
+				continue; //Not enough work this time to need this thread
+			}
+			func = jobFunc;
+			GetRange(worker, begin, end);
+		}
+		{
+			PROFILE_ZONE("JobSystem::Range");
+			(*func)(begin, end, worker);
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobsPending--;
+		}
+		doneCondition.notify_one();
+	}
+}
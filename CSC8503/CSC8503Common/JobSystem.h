@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		A small pool of worker threads for splitting loops up between cores.
+
+		ParallelFor always cuts a loop into the same contiguous ranges for a
+		given item count and worker count, and range N always goes to worker N.
+		Anything written into per-worker buffers can therefore be gathered back
+		up in worker order, and come out the same every time. The calling
+		thread does the first range itself, rather than sitting idle.
+		*/
+		class JobSystem	{
+		public:
+			typedef std::function<void(int begin, int end, int worker)> RangeFunc;
+
+			JobSystem(int workerCount = 1);
+			~JobSystem();
+
+			//Includes the calling thread, so 1 means everything runs inline
+			void SetWorkerCount(int count);
+
+			int GetWorkerCount() const {
+				return workerCount;
+			}
+
+			/*
+			Calls func once per range of [0, count), and waits for them all to
+			finish. Small loops aren't worth waking the workers for, so no range
+			will be given less than minRangeSize items.
+			*/
+			void ParallelFor(int count, const RangeFunc& func, int minRangeSize = 1);
+
+		protected:
+			void StartThreads();
+			void StopThreads();
+			void WorkerThread(int worker, int seenGeneration);
+
+			void GetRange(int worker, int& begin, int& end) const;
+
+			std::vector<std::thread> threads;
+			std::mutex				mutex;
+			std::condition_variable startCondition;
+			std::condition_variable doneCondition;
+
+			const RangeFunc* jobFunc;
+			int		jobCount;
+			int		jobRanges;
+			int		jobsPending;
+			int		generation;
+			bool	quit;
+
+			int		workerCount;
+		};
+	}
+}
@@ -1,9 +1,12 @@
 #pragma once
-#include <winsock2.h>
-#include <enet/enet.h>
+#include <cstring>
 #include <map>
 #include <string>
 
+//Only the .cpp files that talk to ENet include it, as it drags winsock in with it
+typedef struct _ENetHost ENetHost;
+typedef struct _ENetPeer ENetPeer;
+
 enum BasicNetworkMessages {
 	None,
 	Hello,
@@ -5,6 +5,10 @@ namespace NCL {
 	class OBBVolume : CollisionVolume
 	{
 	public:
+		//Taken from the pooled ones in CollisionVolume, which the private inheritance would hide
+		using CollisionVolume::operator new;
+		using CollisionVolume::operator delete;
+
 		OBBVolume(const Maths::Vector3& halfDims) {
 			type		= VolumeType::OBB;
 			halfSizes	= halfDims;
@@ -0,0 +1,282 @@
+#include "PhysicsBodyStore.h"
+#include "PhysicsObject.h"
+#include "Transform.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PhysicsBodyStore::PhysicsBodyStore()	{
+	awakeCount = 0;
+}
+
+PhysicsBodyStore::~PhysicsBodyStore()	{
+	Clear();
+}
+
+/*
+Copies the object's current state in, then makes the object a handle to it.
+New bodies always start off awake.
+*/
+int PhysicsBodyStore::AddBody(PhysicsObject* object, Transform* transform) {
+	int body = (int)owners.size();
+
+	positions.Add(transform->GetLocalPosition());
+	orientations.Add(transform->GetLocalOrientation());
+	previousPositions.Add(transform->GetLocalPosition());
+	previousOrientations.Add(transform->GetLocalOrientation());
+	linearVelocities.Add(object->GetLinearVelocity());
+	angularVelocities.Add(object->GetAngularVelocity());
+	forces.Add(object->GetForce());
+	torques.Add(object->GetTorque());
+	inverseInertias.Add(object->GetInverseInertia());
+	inverseMasses.push_back(object->GetInverseMass());
+	inverseInertiaTensors.push_back(object->GetInertiaTensor());
+	transforms.push_back(transform);
+	owners.push_back(object);
+	restFrames.push_back(0);
+	sleepGroups.push_back(-1);
+
+	object->SetBody(this, body);
+
+	SwapBodies(body, awakeCount);
+	return awakeCount++;
+}
+
+/*
+Hands the body's state back to its object, so that it still behaves sensibly
+once it's out of the physics system. The last body is moved into the gap, and
+its object is told about its new index.
+*/
+void PhysicsBodyStore::RemoveBody(int body) {
+	if (IsAwake(body)) { //keep the awake bodies packed together at the front
+		SwapBodies(body, --awakeCount);
+		body = awakeCount;
+	}
+	PhysicsObject* object = owners[body];
+
+	Vector3 linearVelocity	= linearVelocities.Get(body);
+	Vector3 angularVelocity = angularVelocities.Get(body);
+	Vector3 force			= forces.Get(body);
+	Vector3 torque			= torques.Get(body);
+	Vector3 inverseInertia	= inverseInertias.Get(body);
+	float	inverseMass		= inverseMasses[body];
+
+	object->SetBody(nullptr, -1);
+	object->SetLinearVelocity(linearVelocity);
+	object->SetAngularVelocity(angularVelocity);
+	object->ClearForces();
+	object->AddForce(force);
+	object->AddTorque(torque);
+	object->SetInverseInertia(inverseInertia);
+	object->SetInverseMass(inverseMass);
+	object->UpdateInertiaTensor();
+
+	positions.RemoveSwap(body);
+	orientations.RemoveSwap(body);
+	previousPositions.RemoveSwap(body);
+	previousOrientations.RemoveSwap(body);
+	linearVelocities.RemoveSwap(body);
+	angularVelocities.RemoveSwap(body);
+	forces.RemoveSwap(body);
+	torques.RemoveSwap(body);
+	inverseInertias.RemoveSwap(body);
+
+	inverseMasses[body]			= inverseMasses.back();
+	inverseInertiaTensors[body]	= inverseInertiaTensors.back();
+	transforms[body]			= transforms.back();
+	owners[body]				= owners.back();
+	restFrames[body]			= restFrames.back();
+	sleepGroups[body]			= sleepGroups.back();
+
+	inverseMasses.pop_back();
+	inverseInertiaTensors.pop_back();
+	transforms.pop_back();
+	owners.pop_back();
+	restFrames.pop_back();
+	sleepGroups.pop_back();
+
+	if (body < (int)owners.size()) {
+		owners[body]->SetBody(this, body);
+	}
+}
+
+void PhysicsBodyStore::Clear() {
+	while (!owners.empty()) {
+		RemoveBody((int)owners.size() - 1);
+	}
+}
+
+void PhysicsBodyStore::SwapBodies(int a, int b) {
+	if (a == b) {
+		return;
+	}
+	positions.Swap(a, b);
+	orientations.Swap(a, b);
+	previousPositions.Swap(a, b);
+	previousOrientations.Swap(a, b);
+	linearVelocities.Swap(a, b);
+	angularVelocities.Swap(a, b);
+	forces.Swap(a, b);
+	torques.Swap(a, b);
+	inverseInertias.Swap(a, b);
+
+	std::swap(inverseMasses[a], inverseMasses[b]);
+	std::swap(inverseInertiaTensors[a], inverseInertiaTensors[b]);
+	std::swap(transforms[a], transforms[b]);
+	std::swap(owners[a], owners[b]);
+	std::swap(restFrames[a], restFrames[b]);
+	std::swap(sleepGroups[a], sleepGroups[b]);
+
+	owners[a]->SetBody(this, a);
+	owners[b]->SetBody(this, b);
+}
+
+/*
+A sleeping body has no velocity or forces, and is moved to the end of the awake
+bodies, which are then one shorter.
+*/
+void PhysicsBodyStore::SleepBody(int body, int group) {
+	if (!IsAwake(body)) {
+		return;
+	}
+	linearVelocities.Set(body, Vector3());
+	angularVelocities.Set(body, Vector3());
+	forces.Set(body, Vector3());
+	torques.Set(body, Vector3());
+	restFrames[body]	= 0;
+	sleepGroups[body]	= group;
+
+	SwapBodies(body, --awakeCount);
+}
+
+/*
+Wakes the body and everything that went to sleep along with it - a sleeping
+pile is only stable as a whole, so nudging one body has to wake the rest.
+*/
+void PhysicsBodyStore::WakeBody(int body) {
+	if (IsAwake(body)) {
+		return;
+	}
+	int group = sleepGroups[body];
+
+	for (int i = (int)owners.size() - 1; i >= awakeCount; --i) {
+		if (i == body || (group >= 0 && sleepGroups[i] == group)) {
+			restFrames[i]	= 0;
+			sleepGroups[i]	= -1;
+		}
+	}
+	//Everything being woken now has a group of -1, so sweep them to the front
+	for (int i = awakeCount; i < (int)owners.size(); ++i) {
+		if (sleepGroups[i] == -1) {
+			SwapBodies(i, awakeCount++);
+		}
+	}
+}
+
+void PhysicsBodyStore::WakeAll() {
+	for (int i = awakeCount; i < (int)owners.size(); ++i) {
+		restFrames[i]	= 0;
+		sleepGroups[i]	= -1;
+	}
+	awakeCount = (int)owners.size();
+}
+
+/*
+Game code is free to move objects around between physics updates, so at the
+start of every update the store picks up wherever each body's transform is.
+A sleeping body that has been moved is woken up, as whatever was holding it
+still probably isn't any more.
+*/
+void PhysicsBodyStore::ReadTransforms() {
+	for (int i = 0; i < awakeCount; ++i) {
+		positions.Set(i, transforms[i]->GetLocalPosition());
+		orientations.Set(i, transforms[i]->GetLocalOrientation());
+	}
+
+	movedSleepers.clear();
+	for (int i = awakeCount; i < (int)transforms.size(); ++i) {
+		if (HasMoved(i)) {
+			positions.Set(i, transforms[i]->GetLocalPosition());
+			orientations.Set(i, transforms[i]->GetLocalOrientation());
+			movedSleepers.push_back(owners[i]);
+		}
+	}
+	for (PhysicsObject* object : movedSleepers) {
+		WakeBody(object->GetBodyIndex());
+	}
+}
+
+bool PhysicsBodyStore::HasMoved(int body) const {
+	return transforms[body]->GetLocalPosition() != positions.Get(body) ||
+		transforms[body]->GetLocalOrientation() != orientations.Get(body);
+}
+
+//Collision detection reads world matrices, which have to be kept up to date between steps
+void PhysicsBodyStore::WriteTransform(int body) {
+	transforms[body]->SetLocalPosition(positions.Get(body));
+	transforms[body]->SetLocalOrientation(orientations.Get(body));
+	transforms[body]->UpdateMatrices();
+}
+
+//Sleeping bodies don't move, so their previous state is already their current one
+void PhysicsBodyStore::StorePreviousTransforms() {
+	std::copy(positions.x.begin(), positions.x.begin() + awakeCount, previousPositions.x.begin());
+	std::copy(positions.y.begin(), positions.y.begin() + awakeCount, previousPositions.y.begin());
+	std::copy(positions.z.begin(), positions.z.begin() + awakeCount, previousPositions.z.begin());
+	std::copy(orientations.x.begin(), orientations.x.begin() + awakeCount, previousOrientations.x.begin());
+	std::copy(orientations.y.begin(), orientations.y.begin() + awakeCount, previousOrientations.y.begin());
+	std::copy(orientations.z.begin(), orientations.z.begin() + awakeCount, previousOrientations.z.begin());
+	std::copy(orientations.w.begin(), orientations.w.begin() + awakeCount, previousOrientations.w.begin());
+}
+
+/*
+Gives each awake body's transform a render matrix alpha of the way from where
+it was at the start of the latest step to where it is now. Anything else just
+draws its world matrix.
+*/
+void PhysicsBodyStore::WriteRenderTransforms(float alpha) {
+	for (int i = 0; i < awakeCount; ++i) {
+		Vector3 position = previousPositions.Get(i) + (positions.Get(i) - previousPositions.Get(i)) * alpha;
+		//Steps are short enough that a normalised lerp is as good as a slerp
+		Quaternion orientation = Quaternion::Lerp(previousOrientations.Get(i), orientations.Get(i), alpha);
+		orientation.Normalise();
+
+		transforms[i]->SetRenderState(position, orientation);
+	}
+}
+
+/*
+Sleeping bodies never have any forces on them - they are cleared as the body
+goes to sleep, and adding a force to a body wakes it up first.
+*/
+void PhysicsBodyStore::ClearForces() {
+	std::fill(forces.x.begin(), forces.x.begin() + awakeCount, 0.0f);
+	std::fill(forces.y.begin(), forces.y.begin() + awakeCount, 0.0f);
+	std::fill(forces.z.begin(), forces.z.begin() + awakeCount, 0.0f);
+	std::fill(torques.x.begin(), torques.x.begin() + awakeCount, 0.0f);
+	std::fill(torques.y.begin(), torques.y.begin() + awakeCount, 0.0f);
+	std::fill(torques.z.begin(), torques.z.begin() + awakeCount, 0.0f);
+}
+
+/*
+Rotates each body's inverse inertia into world space, as R * I * R^T. The
+local inverse inertia is diagonal, so each element of the result is just a
+weighted sum of products of two rows of the rotation matrix.
+*/
+void PhysicsBodyStore::UpdateInertiaTensors() {
+	for (int i = 0; i < awakeCount; ++i) {
+		Matrix3 r(orientations.Get(i));
+		Vector3 s = inverseInertias.Get(i);
+		Matrix3& out = inverseInertiaTensors[i];
+
+		for (int row = 0; row < 3; ++row) {
+			for (int col = 0; col < 3; ++col) {
+				out.array[col * 3 + row] =
+					r.array[row] * s.x * r.array[col] +
+					r.array[3 + row] * s.y * r.array[3 + col] +
+					r.array[6 + row] * s.z * r.array[6 + col];
+			}
+		}
+	}
+}
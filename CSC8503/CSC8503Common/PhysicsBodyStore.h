@@ -0,0 +1,187 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include "../../Common/Matrix3.h"
+#include "../../Common/Quaternion.h"
+#include <vector>
+#include <utility>
+
+using namespace NCL::Maths;
+
+namespace NCL {
+	namespace CSC8503 {
+		class PhysicsObject;
+		class Transform;
+
+		//One array per axis, so a loop over lots of vectors reads memory in order
+		struct Vector3Array {
+			std::vector<float> x;
+			std::vector<float> y;
+			std::vector<float> z;
+
+			Vector3 Get(int i) const {
+				return Vector3(x[i], y[i], z[i]);
+			}
+
+			void Set(int i, const Vector3& v) {
+				x[i] = v.x;
+				y[i] = v.y;
+				z[i] = v.z;
+			}
+
+			void Add(const Vector3& v) {
+				x.push_back(v.x);
+				y.push_back(v.y);
+				z.push_back(v.z);
+			}
+
+			void RemoveSwap(int i) {
+				x[i] = x.back(); x.pop_back();
+				y[i] = y.back(); y.pop_back();
+				z[i] = z.back(); z.pop_back();
+			}
+
+			void Swap(int i, int j) {
+				std::swap(x[i], x[j]);
+				std::swap(y[i], y[j]);
+				std::swap(z[i], z[j]);
+			}
+
+			void Clear() {
+				x.clear();
+				y.clear();
+				z.clear();
+			}
+		};
+
+		struct QuaternionArray {
+			std::vector<float> x;
+			std::vector<float> y;
+			std::vector<float> z;
+			std::vector<float> w;
+
+			Quaternion Get(int i) const {
+				return Quaternion(x[i], y[i], z[i], w[i]);
+			}
+
+			void Set(int i, const Quaternion& q) {
+				x[i] = q.x;
+				y[i] = q.y;
+				z[i] = q.z;
+				w[i] = q.w;
+			}
+
+			void Add(const Quaternion& q) {
+				x.push_back(q.x);
+				y.push_back(q.y);
+				z.push_back(q.z);
+				w.push_back(q.w);
+			}
+
+			void RemoveSwap(int i) {
+				x[i] = x.back(); x.pop_back();
+				y[i] = y.back(); y.pop_back();
+				z[i] = z.back(); z.pop_back();
+				w[i] = w.back(); w.pop_back();
+			}
+
+			void Swap(int i, int j) {
+				std::swap(x[i], x[j]);
+				std::swap(y[i], y[j]);
+				std::swap(z[i], z[j]);
+				std::swap(w[i], w[j]);
+			}
+
+			void Clear() {
+				x.clear();
+				y.clear();
+				z.clear();
+				w.clear();
+			}
+		};
+
+		/*
+		The state of every body the physics system is simulating, stored as a
+		structure of arrays. Integration can then step straight through memory,
+		rather than hopping from GameObject to PhysicsObject to Transform.
+
+		A PhysicsObject added to the store becomes a handle to its body - its
+		getters and setters read and write these arrays instead of its own
+		members. Positions and orientations are copies of each body's transform,
+		read in once per physics update and only written back for bodies that
+		have actually moved.
+
+		The positions and orientations from the start of the latest step are
+		also kept, so that the renderer can be given a transform partway
+		between the last two steps.
+
+		Awake bodies are always kept at the front of the arrays, so anything
+		that only cares about moving bodies can just stop at GetAwakeCount().
+		Bodies that are put to sleep together share a sleep group, and waking
+		any one of them wakes the whole group back up.
+		*/
+		class PhysicsBodyStore	{
+		public:
+			PhysicsBodyStore();
+			~PhysicsBodyStore();
+
+			int		AddBody(PhysicsObject* object, Transform* transform);
+			void	RemoveBody(int body);
+			void	Clear();
+
+			int GetBodyCount() const {
+				return (int)owners.size();
+			}
+
+			int GetAwakeCount() const {
+				return awakeCount;
+			}
+
+			bool IsAwake(int body) const {
+				return body < awakeCount;
+			}
+
+			//Groups should be 0 or more
+			void SleepBody(int body, int group);
+			void WakeBody(int body);
+			void WakeAll();
+
+			void ReadTransforms();
+			void WriteTransform(int body);
+
+			//Whether game code has moved the body's transform since the store last read or wrote it
+			bool HasMoved(int body) const;
+
+			void StorePreviousTransforms();
+			void WriteRenderTransforms(float alpha);
+
+			void ClearForces();
+
+			void UpdateInertiaTensors();
+
+			Vector3Array		positions;
+			QuaternionArray		orientations;
+			Vector3Array		previousPositions;
+			QuaternionArray		previousOrientations;
+			Vector3Array		linearVelocities;
+			Vector3Array		angularVelocities;
+			Vector3Array		forces;
+			Vector3Array		torques;
+			Vector3Array		inverseInertias;
+			std::vector<float>	inverseMasses;
+
+			std::vector<Matrix3>		inverseInertiaTensors;
+			std::vector<Transform*>		transforms;
+			std::vector<PhysicsObject*>	owners;
+
+			std::vector<int>	restFrames;		//steps in a row spent below the sleep thresholds
+			std::vector<int>	sleepGroups;	//-1 while awake
+
+		protected:
+			void SwapBodies(int a, int b);
+
+			std::vector<PhysicsObject*> movedSleepers;
+
+			int awakeCount;
+		};
+	}
+}
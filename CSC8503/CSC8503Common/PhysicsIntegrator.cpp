@@ -0,0 +1,195 @@
+#include "PhysicsIntegrator.h"
+#include "PhysicsSimd.h"
+#include <cmath>
+
+using namespace NCL;
+using namespace CSC8503;
+
+int PhysicsIntegrator::GetBatchWidth() {
+	return PHYSICS_SIMD_WIDTH;
+}
+
+/*
+Adds each body's acceleration from its accumulated force, and gravity, onto
+its linear velocity. Infinitely heavy things are never pulled by gravity.
+*/
+void PhysicsIntegrator::IntegrateLinearAccel(PhysicsBodyStore& bodies, const Vector3& gravity, bool applyGravity, float dt) {
+	int first = 0;
+#if PHYSICS_SIMD_WIDTH > 1
+	int count = bodies.GetAwakeCount();
+
+	const float* inverseMass = bodies.inverseMasses.data();
+	const float* fx = bodies.forces.x.data();
+	const float* fy = bodies.forces.y.data();
+	const float* fz = bodies.forces.z.data();
+	float* vx = bodies.linearVelocities.x.data();
+	float* vy = bodies.linearVelocities.y.data();
+	float* vz = bodies.linearVelocities.z.data();
+
+	SimdFloat timestep	= SimdSet(dt);
+	SimdFloat zero		= SimdSet(0.0f);
+	SimdFloat gx		= SimdSet(applyGravity ? gravity.x : 0.0f);
+	SimdFloat gy		= SimdSet(applyGravity ? gravity.y : 0.0f);
+	SimdFloat gz		= SimdSet(applyGravity ? gravity.z : 0.0f);
+
+	for (; first + PHYSICS_SIMD_WIDTH <= count; first += PHYSICS_SIMD_WIDTH) {
+		SimdFloat im		= SimdLoad(inverseMass + first);
+		SimdFloat hasMass	= SimdGreater(im, zero);
+
+		SimdFloat ax = SimdAdd(SimdMul(SimdLoad(fx + first), im), SimdAnd(hasMass, gx));
+		SimdFloat ay = SimdAdd(SimdMul(SimdLoad(fy + first), im), SimdAnd(hasMass, gy));
+		SimdFloat az = SimdAdd(SimdMul(SimdLoad(fz + first), im), SimdAnd(hasMass, gz));
+
+		SimdStore(vx + first, SimdAdd(SimdLoad(vx + first), SimdMul(ax, timestep)));
+		SimdStore(vy + first, SimdAdd(SimdLoad(vy + first), SimdMul(ay, timestep)));
+		SimdStore(vz + first, SimdAdd(SimdLoad(vz + first), SimdMul(az, timestep)));
+	}
+#endif
+	IntegrateLinearAccelScalar(bodies, gravity, applyGravity, dt, first);
+}
+
+void PhysicsIntegrator::IntegrateLinearAccelScalar(PhysicsBodyStore& bodies, const Vector3& gravity, bool applyGravity, float dt, int first) {
+	int count = bodies.GetAwakeCount();
+
+	const float* inverseMass = bodies.inverseMasses.data();
+	const float* fx = bodies.forces.x.data();
+	const float* fy = bodies.forces.y.data();
+	const float* fz = bodies.forces.z.data();
+	float* vx = bodies.linearVelocities.x.data();
+	float* vy = bodies.linearVelocities.y.data();
+	float* vz = bodies.linearVelocities.z.data();
+
+	for (int i = first; i < count; ++i) {
+		float g = (applyGravity && inverseMass[i] > 0) ? 1.0f : 0.0f;
+
+		vx[i] += (fx[i] * inverseMass[i] + gravity.x * g) * dt;
+		vy[i] += (fy[i] * inverseMass[i] + gravity.y * g) * dt;
+		vz[i] += (fz[i] * inverseMass[i] + gravity.z * g) * dt;
+	}
+}
+
+/*
+Moves each body along by its linear velocity, and spins it by its angular
+velocity, renormalising the orientation afterwards. Both velocities are then
+damped.
+*/
+void PhysicsIntegrator::IntegrateVelocity(PhysicsBodyStore& bodies, float damping, float dt) {
+	int first = 0;
+#if PHYSICS_SIMD_WIDTH > 1
+	int count = bodies.GetAwakeCount();
+
+	float* px = bodies.positions.x.data();
+	float* py = bodies.positions.y.data();
+	float* pz = bodies.positions.z.data();
+	float* vx = bodies.linearVelocities.x.data();
+	float* vy = bodies.linearVelocities.y.data();
+	float* vz = bodies.linearVelocities.z.data();
+
+	float* qx = bodies.orientations.x.data();
+	float* qy = bodies.orientations.y.data();
+	float* qz = bodies.orientations.z.data();
+	float* qw = bodies.orientations.w.data();
+	float* wx = bodies.angularVelocities.x.data();
+	float* wy = bodies.angularVelocities.y.data();
+	float* wz = bodies.angularVelocities.z.data();
+
+	SimdFloat timestep		= SimdSet(dt);
+	SimdFloat halfTimestep	= SimdSet(dt * 0.5f);
+	SimdFloat frameDamping	= SimdSet(damping);
+	SimdFloat one			= SimdSet(1.0f);
+
+	for (; first + PHYSICS_SIMD_WIDTH <= count; first += PHYSICS_SIMD_WIDTH) {
+		SimdFloat lx = SimdLoad(vx + first);
+		SimdFloat ly = SimdLoad(vy + first);
+		SimdFloat lz = SimdLoad(vz + first);
+
+		SimdStore(px + first, SimdAdd(SimdLoad(px + first), SimdMul(lx, timestep)));
+		SimdStore(py + first, SimdAdd(SimdLoad(py + first), SimdMul(ly, timestep)));
+		SimdStore(pz + first, SimdAdd(SimdLoad(pz + first), SimdMul(lz, timestep)));
+
+		SimdStore(vx + first, SimdMul(lx, frameDamping));
+		SimdStore(vy + first, SimdMul(ly, frameDamping));
+		SimdStore(vz + first, SimdMul(lz, frameDamping));
+
+		//q += (angVel * dt * 0.5, 0) * q
+		SimdFloat ox = SimdLoad(wx + first);
+		SimdFloat oy = SimdLoad(wy + first);
+		SimdFloat oz = SimdLoad(wz + first);
+
+		SimdFloat ax = SimdMul(ox, halfTimestep);
+		SimdFloat ay = SimdMul(oy, halfTimestep);
+		SimdFloat az = SimdMul(oz, halfTimestep);
+
+		SimdFloat x = SimdLoad(qx + first);
+		SimdFloat y = SimdLoad(qy + first);
+		SimdFloat z = SimdLoad(qz + first);
+		SimdFloat w = SimdLoad(qw + first);
+
+		SimdFloat nx = SimdSub(SimdAdd(SimdAdd(x, SimdMul(ax, w)), SimdMul(ay, z)), SimdMul(az, y));
+		SimdFloat ny = SimdSub(SimdAdd(SimdAdd(y, SimdMul(ay, w)), SimdMul(az, x)), SimdMul(ax, z));
+		SimdFloat nz = SimdSub(SimdAdd(SimdAdd(z, SimdMul(az, w)), SimdMul(ax, y)), SimdMul(ay, x));
+		SimdFloat nw = SimdSub(SimdSub(SimdSub(w, SimdMul(ax, x)), SimdMul(ay, y)), SimdMul(az, z));
+
+		SimdFloat lengthSq = SimdAdd(SimdAdd(SimdAdd(SimdMul(nx, nx), SimdMul(ny, ny)), SimdMul(nz, nz)), SimdMul(nw, nw));
+		SimdFloat t = SimdDiv(one, SimdSqrt(lengthSq));
+
+		SimdStore(qx + first, SimdMul(nx, t));
+		SimdStore(qy + first, SimdMul(ny, t));
+		SimdStore(qz + first, SimdMul(nz, t));
+		SimdStore(qw + first, SimdMul(nw, t));
+
+		SimdStore(wx + first, SimdMul(ox, frameDamping));
+		SimdStore(wy + first, SimdMul(oy, frameDamping));
+		SimdStore(wz + first, SimdMul(oz, frameDamping));
+	}
+#endif
+	IntegrateVelocityScalar(bodies, damping, dt, first);
+}
+
+void PhysicsIntegrator::IntegrateVelocityScalar(PhysicsBodyStore& bodies, float damping, float dt, int first) {
+	int count = bodies.GetAwakeCount();
+
+	float* px = bodies.positions.x.data();
+	float* py = bodies.positions.y.data();
+	float* pz = bodies.positions.z.data();
+	float* vx = bodies.linearVelocities.x.data();
+	float* vy = bodies.linearVelocities.y.data();
+	float* vz = bodies.linearVelocities.z.data();
+
+	float* qx = bodies.orientations.x.data();
+	float* qy = bodies.orientations.y.data();
+	float* qz = bodies.orientations.z.data();
+	float* qw = bodies.orientations.w.data();
+	float* wx = bodies.angularVelocities.x.data();
+	float* wy = bodies.angularVelocities.y.data();
+	float* wz = bodies.angularVelocities.z.data();
+
+	for (int i = first; i < count; ++i) {
+		px[i] += vx[i] * dt;
+		py[i] += vy[i] * dt;
+		pz[i] += vz[i] * dt;
+
+		vx[i] *= damping;
+		vy[i] *= damping;
+		vz[i] *= damping;
+
+		float ax = wx[i] * (dt * 0.5f);
+		float ay = wy[i] * (dt * 0.5f);
+		float az = wz[i] * (dt * 0.5f);
+
+		float x = qx[i] + (ax * qw[i]) + (ay * qz[i]) - (az * qy[i]);
+		float y = qy[i] + (ay * qw[i]) + (az * qx[i]) - (ax * qz[i]);
+		float z = qz[i] + (az * qw[i]) + (ax * qy[i]) - (ay * qx[i]);
+		float w = qw[i] - (ax * qx[i]) - (ay * qy[i]) - (az * qz[i]);
+
+		float t = 1.0f / sqrtf(x * x + y * y + z * z + w * w);
+		qx[i] = x * t;
+		qy[i] = y * t;
+		qz[i] = z * t;
+		qw[i] = w * t;
+
+		wx[i] *= damping;
+		wy[i] *= damping;
+		wz[i] *= damping;
+	}
+}
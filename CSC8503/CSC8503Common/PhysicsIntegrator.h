@@ -0,0 +1,31 @@
+#pragma once
+#include "PhysicsBodyStore.h"
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Batch integration kernels that run over the whole body store at once.
+		When the compiler is targeting AVX, 8 bodies are integrated at a time,
+		and 4 when targeting SSE2 - any bodies left over at the end, or all of
+		them if neither is available, go through a plain scalar loop instead.
+		Defining NCL_PHYSICS_NO_SIMD forces the scalar path. Only the awake
+		bodies at the front of the store are integrated.
+		*/
+		class PhysicsIntegrator	{
+		public:
+			static void IntegrateLinearAccel(PhysicsBodyStore& bodies, const Vector3& gravity, bool applyGravity, float dt);
+			static void IntegrateVelocity(PhysicsBodyStore& bodies, float damping, float dt);
+
+			//How many bodies each SIMD step handles - 1 if there's no SIMD path
+			static int GetBatchWidth();
+
+		protected:
+			static void IntegrateLinearAccelScalar(PhysicsBodyStore& bodies, const Vector3& gravity, bool applyGravity, float dt, int first);
+			static void IntegrateVelocityScalar(PhysicsBodyStore& bodies, float damping, float dt, int first);
+
+		private:
+			PhysicsIntegrator()		{}
+			~PhysicsIntegrator()	{}
+		};
+	}
+}
@@ -8,9 +8,14 @@ PhysicsObject::PhysicsObject(Transform* parentTransform, const CollisionVolume*
 	transform	= parentTransform;
 	volume		= parentVolume;
 
+	bodyStore	= nullptr;
+	bodyIndex	= -1;
+
 	inverseMass = 1.0f;
 	elasticity	= 0.8f;
 	friction	= 0.8f;
+
+	continuousCollision = false;
 }
 
 PhysicsObject::~PhysicsObject()	{
@@ -18,35 +23,65 @@ PhysicsObject::~PhysicsObject()	{
 }
 
 //通过适当的逆质量表示来缩放其输入，并将其添加到适当的速度向量
+//Objects of infinite mass are left completely alone, as several solver threads
+//may be pushing against the same static object at once.
 void PhysicsObject::ApplyAngularImpulse(const Vector3& force) {
+	if (GetInverseMass() == 0.0f) {
+		return;
+	}
 	if (force.Length() > 0) {
 		bool a = true;
 	}
-	angularVelocity += inverseInteriaTensor * force;
+	SetAngularVelocity(GetAngularVelocity() + GetInertiaTensor() * force);
 }
 
 void PhysicsObject::ApplyLinearImpulse(const Vector3& force) {
-	linearVelocity += force * inverseMass;
+	if (GetInverseMass() == 0.0f) {
+		return;
+	}
+	SetLinearVelocity(GetLinearVelocity() + force * GetInverseMass());
 }
 
 void PhysicsObject::AddForce(const Vector3& addedForce) {
-	force += addedForce;
+	if (bodyStore) {
+		if (addedForce != Vector3()) {
+			WakeUp();
+		}
+		bodyStore->forces.Set(bodyIndex, bodyStore->forces.Get(bodyIndex) + addedForce);
+	}
+	else {
+		force += addedForce;
+	}
 }
 
 void PhysicsObject::AddForceAtPosition(const Vector3& addedForce, const Vector3& position) {
 	Vector3 localPos = position - transform->GetWorldPosition();
 
-	force  += addedForce;
-	torque += Vector3::Cross(localPos, addedForce);
+	AddForce(addedForce);
+	AddTorque(Vector3::Cross(localPos, addedForce));
 }
 
 void PhysicsObject::AddTorque(const Vector3& addedTorque) {
-	torque += addedTorque;
+	if (bodyStore) {
+		if (addedTorque != Vector3()) {
+			WakeUp();
+		}
+		bodyStore->torques.Set(bodyIndex, bodyStore->torques.Get(bodyIndex) + addedTorque);
+	}
+	else {
+		torque += addedTorque;
+	}
 }
 
 void PhysicsObject::ClearForces() {
-	force				= Vector3();
-	torque				= Vector3();
+	if (bodyStore) {
+		bodyStore->forces.Set(bodyIndex, Vector3());
+		bodyStore->torques.Set(bodyIndex, Vector3());
+	}
+	else {
+		force				= Vector3();
+		torque				= Vector3();
+	}
 }
 
 void PhysicsObject::InitCubeInertia() {
@@ -56,16 +91,19 @@ void PhysicsObject::InitCubeInertia() {
 
 	Vector3 dimsSqr		= fullWidth * fullWidth;
 
-	inverseInertia.x = (12.0f * inverseMass) / (dimsSqr.y + dimsSqr.z);
-	inverseInertia.y = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.z);
-	inverseInertia.z = (12.0f * inverseMass) / (dimsSqr.x + dimsSqr.y);
+	float invMass = GetInverseMass();
+
+	SetInverseInertia(Vector3(
+		(12.0f * invMass) / (dimsSqr.y + dimsSqr.z),
+		(12.0f * invMass) / (dimsSqr.x + dimsSqr.z),
+		(12.0f * invMass) / (dimsSqr.x + dimsSqr.y)));
 }
 
 void PhysicsObject::InitSphereInertia() {
 	float radius	= transform->GetLocalScale().GetMaxElement();
-	float i			= 2.5f * inverseMass / (radius*radius);
+	float i			= 2.5f * GetInverseMass() / (radius*radius);
 
-	inverseInertia	= Vector3(i, i, i);
+	SetInverseInertia(Vector3(i, i, i));
 }
 
 void PhysicsObject::UpdateInertiaTensor() {
@@ -74,5 +112,11 @@ void PhysicsObject::UpdateInertiaTensor() {
 	Matrix3 invOrientation	= Matrix3(q.Conjugate());
 	Matrix3 orientation		= Matrix3(q);
 
-	inverseInteriaTensor = orientation * Matrix3::Scale(inverseInertia) *invOrientation;
+	Matrix3 tensor = orientation * Matrix3::Scale(GetInverseInertia()) *invOrientation;
+	if (bodyStore) {
+		bodyStore->inverseInertiaTensors[bodyIndex] = tensor;
+	}
+	else {
+		inverseInteriaTensor = tensor;
+	}
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 #include "../../Common/Vector3.h"
 #include "../../Common/Matrix3.h"
+#include "PhysicsBodyStore.h"
+#include "BlockPool.h"
 
 using namespace NCL::Maths;
 
@@ -10,33 +12,74 @@ namespace NCL {
 	namespace CSC8503 {
 		class Transform;
 
-		class PhysicsObject	{
+		/*
+		Until it is added to a physics system, a PhysicsObject keeps its state
+		in its own members. Once added, it becomes a handle to a body in the
+		system's PhysicsBodyStore, and all of its state lives there instead.
+		*/
+		class PhysicsObject : public PooledAllocation<PhysicsObject>	{
 		public:
 			PhysicsObject(Transform* parentTransform, const CollisionVolume* parentVolume);
 			~PhysicsObject();
 
 			Vector3 GetLinearVelocity() const {
-				return linearVelocity;
+				return bodyStore ? bodyStore->linearVelocities.Get(bodyIndex) : linearVelocity;
 			}
 
 			Vector3 GetAngularVelocity() const {
-				return angularVelocity;
+				return bodyStore ? bodyStore->angularVelocities.Get(bodyIndex) : angularVelocity;
 			}
 
 			Vector3 GetTorque() const {
-				return torque;
+				return bodyStore ? bodyStore->torques.Get(bodyIndex) : torque;
 			}
 
 			Vector3 GetForce() const {
-				return force;
+				return bodyStore ? bodyStore->forces.Get(bodyIndex) : force;
 			}
 
 			void SetInverseMass(float invMass) {
-				inverseMass = invMass;
+				if (bodyStore) {
+					bodyStore->inverseMasses[bodyIndex] = invMass;
+				}
+				else {
+					inverseMass = invMass;
+				}
 			}
 
 			float GetInverseMass() const {
-				return inverseMass;
+				return bodyStore ? bodyStore->inverseMasses[bodyIndex] : inverseMass;
+			}
+
+			//How much of its speed an object keeps when it bounces - the two
+			//objects' values are multiplied together for each contact
+			void SetElasticity(float e) {
+				elasticity = e;
+			}
+
+			float GetElasticity() const {
+				return elasticity;
+			}
+
+			void SetFriction(float f) {
+				friction = f;
+			}
+
+			float GetFriction() const {
+				return friction;
+			}
+
+			//Fast movers can be swept along their path each step, so they can't pass through thin objects
+			void SetContinuousCollision(bool state) {
+				continuousCollision = state;
+			}
+
+			bool UsesContinuousCollision() const {
+				return continuousCollision;
+			}
+
+			const CollisionVolume* GetVolume() const {
+				return volume;
 			}
 
 			void ApplyAngularImpulse(const Vector3& force);
@@ -51,12 +94,29 @@ namespace NCL {
 
 			void ClearForces();
 
+			//Setting a sleeping body moving wakes it up - setting it still doesn't
 			void SetLinearVelocity(const Vector3& v) {
-				linearVelocity = v;
+				if (bodyStore) {
+					if (v != Vector3()) {
+						WakeUp();
+					}
+					bodyStore->linearVelocities.Set(bodyIndex, v);
+				}
+				else {
+					linearVelocity = v;
+				}
 			}
 
 			void SetAngularVelocity(const Vector3& v) {
-				angularVelocity = v;
+				if (bodyStore) {
+					if (v != Vector3()) {
+						WakeUp();
+					}
+					bodyStore->angularVelocities.Set(bodyIndex, v);
+				}
+				else {
+					angularVelocity = v;
+				}
 			}
 
 			void InitCubeInertia();
@@ -65,16 +125,53 @@ namespace NCL {
 			void UpdateInertiaTensor();
 
 			Matrix3 GetInertiaTensor() const {
-				return inverseInteriaTensor;
+				return bodyStore ? bodyStore->inverseInertiaTensors[bodyIndex] : inverseInteriaTensor;
+			}
+
+			Vector3 GetInverseInertia() const {
+				return bodyStore ? bodyStore->inverseInertias.Get(bodyIndex) : inverseInertia;
+			}
+
+			void SetInverseInertia(const Vector3& i) {
+				if (bodyStore) {
+					bodyStore->inverseInertias.Set(bodyIndex, i);
+				}
+				else {
+					inverseInertia = i;
+				}
+			}
+
+			//Only the body store should call this!
+			void SetBody(PhysicsBodyStore* store, int index) {
+				bodyStore = store;
+				bodyIndex = index;
+			}
+
+			int GetBodyIndex() const {
+				return bodyIndex;
+			}
+
+			bool IsAsleep() const {
+				return bodyStore && !bodyStore->IsAwake(bodyIndex);
+			}
+
+			void WakeUp() {
+				if (bodyStore) {
+					bodyStore->WakeBody(bodyIndex);
+				}
 			}
 
 		protected:
 			const CollisionVolume* volume;
 			Transform*		transform;
 
+			PhysicsBodyStore*	bodyStore;
+			int					bodyIndex;
+
 			float inverseMass;
 			float elasticity;
 			float friction;
+			bool  continuousCollision;
 
 			//linear stuff
 			Vector3 linearVelocity;
@@ -0,0 +1,75 @@
+#pragma once
+
+/*
+The physics batch kernels are written once against this small set of
+wrappers, which map to either the 8 wide AVX or 4 wide SSE intrinsics
+depending on what the compiler has been told it can use. Unaligned loads are
+used throughout, as the arrays being walked are just std::vectors, or blocks
+on the stack.
+
+Comparisons give a mask per lane of either all bits set or none, which can be
+used to pick between two values with SimdSelect, or turned into a bit per
+lane with SimdMask. With NCL_PHYSICS_NO_SIMD defined, or no SSE2 to go on,
+PHYSICS_SIMD_WIDTH is 1 and none of the wrappers exist, so the kernels that
+use them need a plain loop to fall back on.
+*/
+#if !defined(NCL_PHYSICS_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#define PHYSICS_SIMD_WIDTH 8
+
+typedef __m256 SimdFloat;
+
+static inline SimdFloat SimdLoad(const float* p)				{ return _mm256_loadu_ps(p); }
+static inline void		SimdStore(float* p, SimdFloat v)		{ _mm256_storeu_ps(p, v); }
+static inline SimdFloat SimdSet(float f)						{ return _mm256_set1_ps(f); }
+static inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b)		{ return _mm256_add_ps(a, b); }
+static inline SimdFloat SimdSub(SimdFloat a, SimdFloat b)		{ return _mm256_sub_ps(a, b); }
+static inline SimdFloat SimdMul(SimdFloat a, SimdFloat b)		{ return _mm256_mul_ps(a, b); }
+static inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b)		{ return _mm256_div_ps(a, b); }
+static inline SimdFloat SimdSqrt(SimdFloat a)					{ return _mm256_sqrt_ps(a); }
+static inline SimdFloat SimdMin(SimdFloat a, SimdFloat b)		{ return _mm256_min_ps(a, b); }
+static inline SimdFloat SimdMax(SimdFloat a, SimdFloat b)		{ return _mm256_max_ps(a, b); }
+static inline SimdFloat SimdAnd(SimdFloat a, SimdFloat b)		{ return _mm256_and_ps(a, b); }
+static inline SimdFloat SimdAndNot(SimdFloat a, SimdFloat b)	{ return _mm256_andnot_ps(a, b); }
+static inline SimdFloat SimdOr(SimdFloat a, SimdFloat b)		{ return _mm256_or_ps(a, b); }
+static inline SimdFloat SimdGreater(SimdFloat a, SimdFloat b)	{ return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline SimdFloat SimdLess(SimdFloat a, SimdFloat b)		{ return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline int		SimdMask(SimdFloat a)					{ return _mm256_movemask_ps(a); }
+
+#elif !defined(NCL_PHYSICS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PHYSICS_SIMD_WIDTH 4
+
+typedef __m128 SimdFloat;
+
+static inline SimdFloat SimdLoad(const float* p)				{ return _mm_loadu_ps(p); }
+static inline void		SimdStore(float* p, SimdFloat v)		{ _mm_storeu_ps(p, v); }
+static inline SimdFloat SimdSet(float f)						{ return _mm_set1_ps(f); }
+static inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b)		{ return _mm_add_ps(a, b); }
+static inline SimdFloat SimdSub(SimdFloat a, SimdFloat b)		{ return _mm_sub_ps(a, b); }
+static inline SimdFloat SimdMul(SimdFloat a, SimdFloat b)		{ return _mm_mul_ps(a, b); }
+static inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b)		{ return _mm_div_ps(a, b); }
+static inline SimdFloat SimdSqrt(SimdFloat a)					{ return _mm_sqrt_ps(a); }
+static inline SimdFloat SimdMin(SimdFloat a, SimdFloat b)		{ return _mm_min_ps(a, b); }
+static inline SimdFloat SimdMax(SimdFloat a, SimdFloat b)		{ return _mm_max_ps(a, b); }
+static inline SimdFloat SimdAnd(SimdFloat a, SimdFloat b)		{ return _mm_and_ps(a, b); }
+static inline SimdFloat SimdAndNot(SimdFloat a, SimdFloat b)	{ return _mm_andnot_ps(a, b); }
+static inline SimdFloat SimdOr(SimdFloat a, SimdFloat b)		{ return _mm_or_ps(a, b); }
+static inline SimdFloat SimdGreater(SimdFloat a, SimdFloat b)	{ return _mm_cmpgt_ps(a, b); }
+static inline SimdFloat SimdLess(SimdFloat a, SimdFloat b)		{ return _mm_cmplt_ps(a, b); }
+static inline int		SimdMask(SimdFloat a)					{ return _mm_movemask_ps(a); }
+
+#else
+#define PHYSICS_SIMD_WIDTH 1
+#endif
+
+#if PHYSICS_SIMD_WIDTH > 1
+//a where the mask is set, b where it isn't
+static inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) {
+	return SimdOr(SimdAnd(mask, a), SimdAndNot(mask, b));
+}
+
+static inline SimdFloat SimdAbs(SimdFloat a) {
+	return SimdAndNot(SimdSet(-0.0f), a);
+}
+#endif
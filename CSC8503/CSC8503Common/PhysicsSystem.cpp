@@ -1,4 +1,6 @@
 ﻿#include "PhysicsSystem.h"
+#include "PhysicsIntegrator.h"
+#include "ContactSolver.h"
 #include "PhysicsObject.h"
 #include "GameObject.h"
 #include "CollisionDetection.h"
@@ -7,26 +9,165 @@
 #include "Constraint.h"
 
 #include "Debug.h"
+#include "Profiler.h"
 
 #include <functional>
+#include <algorithm>
 using namespace NCL;
 using namespace CSC8503;
 
 PhysicsSystem::PhysicsSystem(GameWorld& g) : gameWorld(g)	{
 	applyGravity	= false;
-	useBroadPhase	= false;	
+	useBroadPhase	= true;
 	dTOffset		= 0.0f;
+	interpolationAlpha	= 0.0f;
 	globalDamping	= 0.95f;
 	SetGravity(Vector3(0.0f, -9.8f, 0.0f));
+	SetWorkerCount((int)std::thread::hardware_concurrency());
+
+	for (int i = 0; i < 32; ++i) {
+		layerCollisions[i]	= ~0u;
+		layerReports[i]		= 0;
+	}
+	ClearCollisionEvents();
+
+	gameWorld.SetObjectAddedFunc([&](GameObject* o) { AddToPhysics(o); });
+	gameWorld.SetObjectRemovedFunc([&](GameObject* o) { RemoveFromPhysics(o); });
+	gameWorld.SetObjectsRemovedFunc([&]() { FlushRemovedObjects(); });
+	UpdateRaycastFunc();
 }
 
 PhysicsSystem::~PhysicsSystem()	{
+	gameWorld.SetObjectAddedFunc(nullptr);
+	gameWorld.SetObjectRemovedFunc(nullptr);
+	gameWorld.SetObjectsRemovedFunc(nullptr);
+	gameWorld.SetDynamicRaycastFunc(nullptr);
 }
 
 void PhysicsSystem::SetGravity(const Vector3& g) {
 	gravity = g;
 }
 
+/*
+Only one broadphase structure is kept up to date at a time, so swapping
+means moving every proxy across from one to the other.
+*/
+void PhysicsSystem::UseSweepAndPrune(bool state) {
+	if (state == useSweepAndPrune) {
+		return;
+	}
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetDynamicObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		(*i)->SetBroadphaseProxy(-1);
+	}
+	broadphaseTree.Clear();
+	sweepAndPrune.Clear();
+
+	useSweepAndPrune = state;
+	UpdateRaycastFunc();
+
+	for (auto i = first; i != last; ++i) {
+		AddToBroadPhase(*i);
+	}
+}
+
+void PhysicsSystem::SetLayerCollisions(int layerA, int layerB, bool state) {
+	if (state) {
+		layerCollisions[layerA] |= 1u << layerB;
+		layerCollisions[layerB] |= 1u << layerA;
+	}
+	else {
+		layerCollisions[layerA] &= ~(1u << layerB);
+		layerCollisions[layerB] &= ~(1u << layerA);
+	}
+}
+
+void PhysicsSystem::SetLayerReports(int layerA, int layerB, bool state) {
+	if (state) {
+		layerReports[layerA] |= 1u << layerB;
+		layerReports[layerB] |= 1u << layerA;
+	}
+	else {
+		layerReports[layerA] &= ~(1u << layerB);
+		layerReports[layerB] &= ~(1u << layerA);
+	}
+}
+
+/*
+The world's rays can be walked through the broadphase tree. Its fat boxes
+are only refit during a physics update, so anything game code has moved
+since then has its proxy refit before the rays go in. Sweep and prune
+keeps no hierarchy to walk, so then the world checks each dynamic object's
+bounds itself, where it is now.
+*/
+void PhysicsSystem::UpdateRaycastFunc() {
+	if (!useBroadPhase || useSweepAndPrune) {
+		gameWorld.SetDynamicRaycastFunc(nullptr);
+		return;
+	}
+	gameWorld.SetDynamicRaycastFunc([&](const BroadphaseRayPacket& rays, const RaycastVisitor& visit) {
+		broadphaseTree.RayCastPacket(rays, [&](int proxy, int ray, float& distance) {
+			return visit(broadphaseTree.GetObject(proxy), ray, distance);
+		});
+	}, [&]() {
+		RefitMovedProxies();
+	});
+}
+
+/*
+The body store knows where every body was when it last read or wrote its
+transform, so any transform that no longer matches has been moved by game
+code since - teleported, or put back where it started. Those proxies are
+moved to wherever the object is now, which only costs a tree update for the
+ones that have left their fat box.
+*/
+void PhysicsSystem::RefitMovedProxies() {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetDynamicObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		int body	= (*i)->GetPhysicsObject()->GetBodyIndex();
+		int proxy	= (*i)->GetBroadphaseProxy();
+		if (body == -1 || proxy == -1 || !bodies.HasMoved(body)) {
+			continue;
+		}
+		(*i)->UpdateBroadphaseAABB();
+
+		Vector3 halfSizes;
+		(*i)->GetBroadphaseAABB(halfSizes);
+		broadphaseTree.MoveProxy(proxy, (*i)->GetConstTransform().GetWorldPosition(), halfSizes, Vector3());
+	}
+}
+
+/*
+Every stage splits its work up in the same way for a given worker count, and
+gathers the results back in the same order, so a fixed worker count always
+gives the same simulation. Small scenes don't have enough work to wake the
+workers for, and just run on the calling thread.
+*/
+void PhysicsSystem::SetWorkerCount(int count) {
+	jobs.SetWorkerCount(count);
+	PrepareWorkerBuffers();
+}
+
+void PhysicsSystem::UseSleeping(bool state) {
+	useSleeping = state;
+	if (!useSleeping) {
+		bodies.WakeAll();
+	}
+}
+
+void PhysicsSystem::PrepareWorkerBuffers() {
+	workerBuffers.resize(jobs.GetWorkerCount());
+	for (auto& buffer : workerBuffers) {
+		buffer.clear();
+	}
+}
+
 /*
 
 If the 'game' is ever reset, the PhysicsSystem must be
@@ -38,117 +179,348 @@ any collisions they are in.
 
 */
 void PhysicsSystem::Clear() {
-	allCollisions.clear();
+	allCollisions.Clear();
+	removedObjects.clear();
+	ClearCollisionEvents();
+}
+
+void PhysicsSystem::ClearCollisionEvents() {
+	collisionEvents.clear();
+	for (int& count : eventCounts) {
+		count = 0;
+	}
 }
 
 /*
 
 This is the core of the physics engine update
 调用IntegrateAccel和IntegrateVelocity方法
+
+Time is accumulated, and then spent in steps of exactly fixedDeltaTime, so the
+simulation behaves the same whatever the frame rate is. If the game falls so
+far behind that catching up would take more than maxSubsteps steps, the extra
+time is thrown away rather than letting each frame get slower than the last.
+Whatever time is left over is used to place each body partway between its
+last two steps for rendering.
 */
 void PhysicsSystem::Update(float dt) {
-	GameTimer testTimer;
-	testTimer.GetTimeDeltaSeconds();
-
-	frameDT = dt;
+	PROFILE_ZONE("PhysicsSystem::Update");
+	GameTimer updateTimer;
+	GameTimer phaseTimer;
+	stepStats = PhysicsStepStats();
 
 	dTOffset += dt; //We accumulate time delta here - there might be remainders from previous frame!
 
-	float iterationDt = 1.0f / 120.0f; //Ideally we'll have 120 physics updates a second 
+	//Whatever the game hasn't looked at from the last update is thrown away
+	ClearCollisionEvents();
 
-	if (dTOffset > 8 * iterationDt) { //the physics engine cant catch up!
-		iterationDt = 1.0f / 15.0f; //it'll just have to run bigger timesteps...
-		//std::cout << "Setting physics iterations to 15" << iterationDt << std::endl;
-	}
-	else if (dTOffset > 4  * iterationDt) { //the physics engine cant catch up!
-		iterationDt = 1.0f / 30.0f; //it'll just have to run bigger timesteps...
-		//std::cout << "Setting iteration dt to 4 case " << iterationDt << std::endl;
-	}
-	else if (dTOffset > 2* iterationDt) { //the physics engine cant catch up!
-		iterationDt = 1.0f / 60.0f; //it'll just have to run bigger timesteps...
-		//std::cout << "Setting iteration dt to 2 case " << iterationDt << std::endl;
-	}
-	else {
-		//std::cout << "Running normal update " << iterationDt << std::endl;
+	float maxOffset = fixedDeltaTime * maxSubsteps;
+	if (dTOffset > maxOffset) { //the physics engine cant catch up!
+		dTOffset = maxOffset;	//so the simulation will just have to run slow for a bit
 	}
 
 	int constraintIterationCount = 10;
-	iterationDt = dt;
 
-	if (useBroadPhase) {
-		UpdateObjectAABBs();
-	}
+	bodies.ReadTransforms();
+
+	//Adding up frame times never quite comes out exact, so a step that's only
+	//short by a rounding error is taken now rather than left for next frame
+	float stepTolerance = fixedDeltaTime * 0.001f;
+
+	int steps = 0;
+	while(dTOffset + stepTolerance >= fixedDeltaTime) {
+		PROFILE_ZONE("PhysicsSystem::Step");
+		bodies.StorePreviousTransforms();
+
+		phaseTimer.Tick();
+		if (useBroadPhase) {
+			UpdateObjectAABBs();
+		}
+		phaseTimer.Tick();
+		stepStats.broadphaseTime += phaseTimer.GetTimeDeltaSeconds();
+
+		IntegrateAccel(fixedDeltaTime); //Update accelerations from external forces
+		phaseTimer.Tick();
+		stepStats.integrateTime += phaseTimer.GetTimeDeltaSeconds();
 
-	while(dTOffset > iterationDt *0.5) {
-		IntegrateAccel(iterationDt); //Update accelerations from external forces
 		if (useBroadPhase) {
 			BroadPhase();
+			phaseTimer.Tick();
+			stepStats.broadphaseTime += phaseTimer.GetTimeDeltaSeconds();
+
 			NarrowPhase();
+			phaseTimer.Tick();
+			stepStats.narrowphaseTime += phaseTimer.GetTimeDeltaSeconds();
+
+			SolveIslands(fixedDeltaTime, solverIterations);
+			phaseTimer.Tick();
+			stepStats.solveTime += phaseTimer.GetTimeDeltaSeconds();
+
+			stepStats.broadphasePairs	= (int)broadphaseCollisions.size();
+			stepStats.contacts			= (int)contacts.size();
 		}
 		else {
 			BasicCollisionDetection();
-		}
+			phaseTimer.Tick();
+			stepStats.narrowphaseTime += phaseTimer.GetTimeDeltaSeconds();
 
-		//This is our simple iterative solver - 
-		//we just run things multiple times, slowly moving things forward
-		//and then rechecking that the constraints have been met		
-		float constraintDt = iterationDt /  (float)constraintIterationCount;
+			//This is our simple iterative solver - 
+			//we just run things multiple times, slowly moving things forward
+			//and then rechecking that the constraints have been met		
+			float constraintDt = fixedDeltaTime /  (float)constraintIterationCount;
 
-		for (int i = 0; i < constraintIterationCount; ++i) {
-			UpdateConstraints(constraintDt);	
+			std::vector<Constraint*>::const_iterator first;
+			std::vector<Constraint*>::const_iterator last;
+			gameWorld.GetConstraintIterators(first, last);
+
+			constraintSolver.Clear();
+			for (auto i = first; i != last; ++i) {
+				constraintSolver.AddConstraint(*i);
+			}
+			constraintSolver.Prepare(bodies, constraintDt);
+
+			for (int i = 0; i < constraintIterationCount; ++i) {
+				UpdateConstraints(constraintDt);	
+			}
+			phaseTimer.Tick();
+			stepStats.solveTime += phaseTimer.GetTimeDeltaSeconds();
 		}
 		
-		IntegrateVelocity(iterationDt); //update positions from new velocity changes
+		IntegrateVelocity(fixedDeltaTime); //update positions from new velocity changes
+		phaseTimer.Tick();
+		stepStats.integrateTime += phaseTimer.GetTimeDeltaSeconds();
+
+		if (useBroadPhase) {
+			ContinuousCollision();
+		}
+		phaseTimer.Tick();
+		stepStats.continuousTime += phaseTimer.GetTimeDeltaSeconds();
+
+		if (useBroadPhase && useSleeping) {
+			UpdateSleeping();
+		}
+		phaseTimer.Tick();
+		stepStats.sleepingTime += phaseTimer.GetTimeDeltaSeconds();
+
+		UpdateCollisionList(); //Remove any old collisions
+		phaseTimer.Tick();
+		stepStats.collisionListTime += phaseTimer.GetTimeDeltaSeconds();
 
-		dTOffset -= iterationDt; 
+		dTOffset -= fixedDeltaTime; 
+		steps++;
 	}
-	ClearForces();	//Once we've finished with the forces, reset them to zero
+	//Forces are kept until a step has actually used them
+	if (steps > 0) {
+		ClearForces();	//Once we've finished with the forces, reset them to zero
+	}
+
+	interpolationAlpha = dTOffset > 0.0f ? dTOffset / fixedDeltaTime : 0.0f;
+	bodies.WriteRenderTransforms(interpolationAlpha);
+
+	stepStats.steps			= steps;
+	stepStats.trackedPairs	= allCollisions.GetCount();
+	stepStats.awakeBodies	= bodies.GetAwakeCount();
 
-	UpdateCollisionList(); //Remove any old collisions
-	//std::cout << iteratorCount << " , " << iterationDt << std::endl;
-	float time = testTimer.GetTimeDeltaSeconds();
-	//std::cout << "Physics time taken: " << time << std::endl;
+	updateTimer.Tick();
+	stepStats.totalTime = updateTimer.GetTimeDeltaSeconds();
 }
 
 /*
 Later on we're going to need to keep track of collisions
-across multiple frames, so we store them in a set.
+across multiple steps, so we store them in a pair cache. Every
+step a pair is still touching, its framesLeft is topped back up.
 
-The first time they are added, we tell the objects they are colliding.
-The frame they are to be removed, we tell them they're no longer colliding.
+The first time they are added, a begin event is raised for them, and every
+step after that a stay event, until the step they are removed, which raises
+an end event. The events are only buffered up here - nothing outside of the
+physics system is called until the game asks for them after the update.
 
 From this simple mechanism, we we build up gameplay interactions inside the
 OnCollisionBegin / OnCollisionEnd functions (removing health when hit by a 
 rocket launcher, gaining a point when the player hits the gold coin, and so on).
 */
 void PhysicsSystem::UpdateCollisionList() {
-	for (std::set<CollisionDetection::CollisionInfo>::iterator i = allCollisions.begin(); i != allCollisions.end(); ) {
-		if ((*i).framesLeft == numCollisionFrames) {
-			i->a->OnCollisionBegin(i->b);
-			i->b->OnCollisionBegin(i->a);
-		}
-		(*i).framesLeft = (*i).framesLeft - 1;
-		if ((*i).framesLeft < 0) {
-			i->a->OnCollisionEnd(i->b);
-			i->b->OnCollisionEnd(i->a);
-			i = allCollisions.erase(i);
+	PROFILE_ZONE("PhysicsSystem::UpdateCollisionList");
+	for (int i = 0; i < allCollisions.GetCount(); ) {
+		CollisionPair& pair = allCollisions.GetPair(i);
+		GameObject* a = pair.info.a;
+		GameObject* b = pair.info.b;
+
+		bool begun = !pair.hasBegun;
+		pair.hasBegun = true;
+		pair.info.framesLeft = pair.info.framesLeft - 1;
+
+		bool ended = pair.info.framesLeft < 0;
+		if (ended) {
+			allCollisions.RemoveAt(i);
 		}
 		else {
 			++i;
 		}
+		if (begun) {
+			AddCollisionEvent(a, b, CollisionEventType::Begin);
+		}
+		if (ended) {
+			AddCollisionEvent(a, b, CollisionEventType::End);
+		}
+		else if (!begun) {
+			AddCollisionEvent(a, b, CollisionEventType::Stay);
+		}
+	}
+}
+
+void PhysicsSystem::AddCollisionEvent(GameObject* a, GameObject* b, CollisionEventType type) {
+	collisionEvents.emplace_back(a, b, type);
+	eventCounts[(int)type]++;
+}
+
+/*
+Passes the last update's begin and end events on to each object's
+OnCollisionBegin and OnCollisionEnd, for the pairs with an object on any of
+the given layers. Events are copied out before each callback, as gameplay
+code might remove objects from the world, which strikes them from the buffer.
+*/
+void PhysicsSystem::DispatchCollisionEvents(unsigned int layerMask) {
+	for (size_t i = 0; i < collisionEvents.size(); ++i) {
+		CollisionEvent e = collisionEvents[i];
+		if (!e.a || !e.b || !((e.a->GetCollisionLayerMask() | e.b->GetCollisionLayerMask()) & layerMask)) {
+			continue;
+		}
+		if (e.type == CollisionEventType::Begin) {
+			e.a->OnCollisionBegin(e.b);
+			e.b->OnCollisionBegin(e.a);
+		}
+		else if (e.type == CollisionEventType::End) {
+			e.a->OnCollisionEnd(e.b);
+			e.b->OnCollisionEnd(e.a);
+		}
 	}
 }
 
+/*
+Every dynamic object keeps a proxy in the broadphase tree for as long as it is
+in the world - static objects live in the world's own static index instead.
+Moving a proxy is just a containment test against its fat box, so only
+objects that have actually left their box cost us a tree update. Sleeping
+objects can't have moved at all, so are skipped entirely.
+*/
 void PhysicsSystem::UpdateObjectAABBs() {
+	PROFILE_ZONE("PhysicsSystem::UpdateObjectAABBs");
 	std::vector<GameObject*>::const_iterator first;
 	std::vector<GameObject*>::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
+	gameWorld.GetDynamicObjectIterators(first, last);
 
 	for (auto i = first; i != last; ++i) {
+		if ((*i)->GetPhysicsObject()->IsAsleep()) {
+			continue; //hasn't moved since it went to sleep
+		}
 		(*i)->UpdateBroadphaseAABB();
+
+		int proxy = (*i)->GetBroadphaseProxy();
+		if (proxy == -1) {
+			AddToBroadPhase(*i); //might have been given a volume since it was added
+			continue;
+		}
+		Vector3 halfSizes;
+		(*i)->GetBroadphaseAABB(halfSizes);
+		Vector3 pos = (*i)->GetConstTransform().GetWorldPosition();
+
+		if (useSweepAndPrune) {
+			sweepAndPrune.MoveProxy(proxy, pos, halfSizes);
+		}
+		else {
+			Vector3 displacement = (*i)->GetPhysicsObject()->GetLinearVelocity() * fixedDeltaTime;
+			broadphaseTree.MoveProxy(proxy, pos, halfSizes, displacement);
+		}
 	}
 }
 
+/*
+Every dynamic object gets a body in the body store, which its PhysicsObject
+then acts as a handle to, and a proxy in the broadphase.
+*/
+void PhysicsSystem::AddToPhysics(GameObject* o) {
+	PhysicsObject* physics = o->GetPhysicsObject();
+	if (!o->IsStatic() && physics && physics->GetBodyIndex() == -1) {
+		bodies.AddBody(physics, &o->GetTransform());
+	}
+	AddToBroadPhase(o);
+}
+
+void PhysicsSystem::RemoveFromPhysics(GameObject* o) {
+	RemoveFromBroadPhase(o);
+
+	PhysicsObject* physics = o->GetPhysicsObject();
+	if (physics && physics->GetBodyIndex() != -1) {
+		bodies.RemoveBody(physics->GetBodyIndex());
+	}
+}
+
+void PhysicsSystem::AddToBroadPhase(GameObject* o) {
+	//Objects without a physics object can't be resolved, so never become pairs
+	if (o->GetBroadphaseProxy() != -1 || o->IsStatic() || !o->GetBoundingVolume() || !o->GetPhysicsObject()) {
+		return;
+	}
+	o->UpdateBroadphaseAABB();
+
+	Vector3 halfSizes;
+	o->GetBroadphaseAABB(halfSizes);
+	Vector3 pos = o->GetConstTransform().GetWorldPosition();
+
+	if (useSweepAndPrune) {
+		o->SetBroadphaseProxy(sweepAndPrune.InsertProxy(o, pos, halfSizes));
+	}
+	else {
+		o->SetBroadphaseProxy(broadphaseTree.InsertProxy(o, pos, halfSizes));
+	}
+}
+
+void PhysicsSystem::RemoveFromBroadPhase(GameObject* o) {
+	if (o->GetBroadphaseProxy() != -1) {
+		if (useSweepAndPrune) {
+			sweepAndPrune.RemoveProxy(o->GetBroadphaseProxy());
+		}
+		else {
+			broadphaseTree.RemoveProxy(o->GetBroadphaseProxy());
+		}
+		o->SetBroadphaseProxy(-1);
+	}
+	removedObjects.emplace_back(o);
+}
+
+/*
+Takes the pairs and events of every object removed since the last flush out
+in a single pass over the pair cache and event buffer, however many objects
+went, rather than one pass per object. The world calls this once it has
+removed a batch of objects, and before it deletes any of them.
+*/
+void PhysicsSystem::FlushRemovedObjects() {
+	if (removedObjects.empty()) {
+		return;
+	}
+	std::sort(removedObjects.begin(), removedObjects.end());
+	auto removed = [&](GameObject* o) {
+		return std::binary_search(removedObjects.begin(), removedObjects.end(), o);
+	};
+	for (int i = 0; i < allCollisions.GetCount(); ) {
+		const CollisionPair& pair = allCollisions.GetPair(i);
+		if (removed(pair.info.a) || removed(pair.info.b)) {
+			allCollisions.RemoveAt(i);
+		}
+		else {
+			++i;
+		}
+	}
+	//The buffer may be being worked through, so events are blanked out rather than removed
+	for (CollisionEvent& e : collisionEvents) {
+		if (e.a && (removed(e.a) || removed(e.b))) {
+			e.a = nullptr;
+			e.b = nullptr;
+		}
+	}
+	removedObjects.clear();
+}
+
 /*
 
 This is how we'll be doing collision detection in tutorial 4.
@@ -157,51 +529,58 @@ ensures this), and determine whether they collide, and if so, add them
 to the collision set for later processing. The set will guarantee that
 a particular pair will only be added once, so objects colliding for
 multiple frames won't flood the set with duplicates.
+
+Only the dynamic objects are stepped through like this - static objects
+are found by asking the world's static index what is near each dynamic
+object, so two walls are never tested against each other.
 */
 void PhysicsSystem::BasicCollisionDetection() {
+	PROFILE_ZONE("PhysicsSystem::BasicCollisionDetection");
 	std::vector < GameObject* >::const_iterator first;
 	std::vector < GameObject* >::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
+	gameWorld.GetDynamicObjectIterators(first, last);
 	
 		for (auto i = first; i != last; ++i) {
-		if ((*i)->GetPhysicsObject() == nullptr) {
+		for (auto j = i + 1; j != last; ++j) {
+			TestCollision(*i, *j);
+		}
+		if (!(*i)->GetBoundingVolume()) {
 			continue;
-			
 		}
-		for (auto j = i + 1; j != last; ++j) {
-			if ((*j)->GetPhysicsObject() == nullptr) {
-				continue;
-				
-			}
-			CollisionDetection::CollisionInfo info;
-			if (CollisionDetection::ObjectIntersection(*i, *j, info)) {
-				ImpulseResolveCollision(*info.a, *info.b, info.point);
-				 std::cout << " Collision between " << (*i)->GetName()<< " and " << (*j)->GetName() << std::endl;
-
-				 if ((*i)->GetName() == "goose" && (*j)->GetName() == "apple")
-				 {
-					 apple_goose_detection = true;
-				 }
-
-				 if ((*i)->GetName() == "goose" && (*j)->GetName() == "water")
-				 {
-					 goose_water_detection = true;
-				 }
-
+		(*i)->UpdateBroadphaseAABB();
 
-				 if ((*i)->GetName() == "apple" && (*j)->GetName() == "myisland")
-				 {
-					 apple_island_detection = true;
-				 }
+		Vector3 halfSizes;
+		(*i)->GetBroadphaseAABB(halfSizes);
+		BroadphaseBounds bounds((*i)->GetConstTransform().GetWorldPosition(), halfSizes);
 
+		gameWorld.QueryStaticObjects(bounds, [&](GameObject* other) {
+			TestCollision(*i, other);
+		});
+	}
+}
 
-				info.framesLeft = numCollisionFrames;
-				allCollisions.insert(info);
-				
+void PhysicsSystem::TestCollision(GameObject* a, GameObject* b) {
+	if (!CanCollide(a, b)) {
+		return;
+	}
+	CollisionDetection::CollisionInfo info;
+	if (CollisionDetection::ObjectIntersection(a, b, info)) {
+		if (!a->IsTrigger() && !b->IsTrigger()) {
+			//This simple resolver only handles one point, so uses the middle of the manifold
+			CollisionDetection::ContactPoint point = info.points[0];
+			for (int i = 1; i < info.pointCount; ++i) {
+				point.localA += info.points[i].localA;
+				point.localB += info.points[i].localB;
 			}
-			
+			point.localA = point.localA / (float)info.pointCount;
+			point.localB = point.localB / (float)info.pointCount;
+
+			ImpulseResolveCollision(*info.a, *info.b, point);
 		}
-		
+		ReportContact(a, b);
+
+		info.framesLeft = numCollisionFrames;
+		allCollisions.Insert(info);
 	}
 }
 
@@ -211,7 +590,7 @@ In tutorial 5, we start determining the correct response to a collision,
 so that objects separate back out. 
 
 */
-void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) const {
+void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, CollisionDetection::ContactPoint& p) {
 	//两个碰撞对象的物理对象及其变换
 	PhysicsObject* physA = a.GetPhysicsObject();
 	PhysicsObject * physB = b.GetPhysicsObject();
@@ -222,9 +601,21 @@ void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, Collis
 		float totalMass = physA->GetInverseMass() + physB->GetInverseMass(); //总逆质量
 	
 		// Separate them out using projection大小与穿透距离和物体的反质量
-		transformA.SetWorldPosition(transformA.GetWorldPosition() -(p.normal * p.penetration * (physA->GetInverseMass() / totalMass)));
+		//Static objects are never moved - other islands may be resolving against them too
+		if (physA->GetInverseMass() > 0.0f) {
+			transformA.SetWorldPosition(transformA.GetWorldPosition() -(p.normal * p.penetration * (physA->GetInverseMass() / totalMass)));
+		}
 	//逆质量，因此较重的对象具有较低的值
-		transformB.SetWorldPosition(transformB.GetWorldPosition() +(p.normal * p.penetration * (physB->GetInverseMass() / totalMass)));
+		if (physB->GetInverseMass() > 0.0f) {
+			transformB.SetWorldPosition(transformB.GetWorldPosition() +(p.normal * p.penetration * (physB->GetInverseMass() / totalMass)));
+		}
+		//the body store has its own copy of each position, which must be kept in step
+		if (physA->GetBodyIndex() != -1) {
+			bodies.positions.Set(physA->GetBodyIndex(), transformA.GetLocalPosition());
+		}
+		if (physB->GetBodyIndex() != -1) {
+			bodies.positions.Set(physB->GetBodyIndex(), transformB.GetLocalPosition());
+		}
 
 		Vector3 relativeA = p.localA; //有问题collisionDetection
 		Vector3 relativeB = p.localB;
@@ -248,7 +639,7 @@ void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, Collis
 			Vector3::Cross(relativeB, p.normal), relativeB);
 		float angularEffect = Vector3::Dot(inertiaA + inertiaB, p.normal);
 		
-			float cRestitution = 0.66f; // disperse some kinectic energy
+			float cRestitution = physA->GetElasticity() * physB->GetElasticity(); // disperse some kinectic energy
 		
 			 float j = (-(1.0f + cRestitution) * impulseForce) /
 			 (totalMass + angularEffect);
@@ -266,61 +657,341 @@ void PhysicsSystem::ImpulseResolveCollision(GameObject& a, GameObject& b, Collis
 Later, we replace the BasicCollisionDetection method with a broadphase
 and a narrowphase collision detection method. In the broad phase, we
 split the world up using an acceleration structure, so that we can only
-compare the collisions that we absolutely need to. 
+compare the collisions that we absolutely need to.
 
+The acceleration structure is a dynamic AABB tree that lives across frames,
+so rather than rebuilding it every step, we just ask it which proxies overlap
+each object. Alternatively, a sort-and-sweep broadphase can be used, which
+does well when objects move coherently. Either way, only dynamic objects are
+held in it - each one then asks the world's static index for any walls etc
+nearby, so pairs of immovable objects are never generated. For the same
+reason, sleeping objects are only ever paired up with awake ones.
 */
 
 void PhysicsSystem::BroadPhase() {
+	PROFILE_ZONE("PhysicsSystem::BroadPhase");
 	broadphaseCollisions.clear();
-	QuadTree < GameObject*> tree(Vector2(1024, 1024), 7, 6);
+
+	//Pairs are put in world ID order rather than by address, so the same
+	//scene always makes the same pairs, however its objects were allocated
+	auto makePair = [](GameObject* a, GameObject* b) {
+		CollisionDetection::CollisionInfo info;
+		bool swap = b->GetWorldID() < a->GetWorldID();
+		info.a = swap ? b : a;
+		info.b = swap ? a : b;
+		return info;
+	};
+
+	if (useSweepAndPrune) {
+		sweepAndPrune.UpdateAxes();
+		sweepAndPrune.FindPairs([&](GameObject* a, GameObject* b) {
+			if ((!a->GetPhysicsObject()->IsAsleep() || !b->GetPhysicsObject()->IsAsleep()) && CanCollide(a, b)) {
+				broadphaseCollisions.emplace_back(makePair(a, b));
+			}
+		});
+	}
 
 	std::vector < GameObject* >::const_iterator first;
 	std::vector < GameObject* >::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
-	for (auto i = first; i != last; ++i) {
-		Vector3 halfSizes;
-		if (!(*i)->GetBroadphaseAABB(halfSizes)) {
-			continue;
+	gameWorld.GetDynamicObjectIterators(first, last);
 
-		}
-		Vector3 pos = (*i)->GetConstTransform().GetWorldPosition();
-		tree.Insert(*i, pos, halfSizes);
-	}
+	//Queries only read the trees, so each worker takes a run of objects,
+	//and writes whatever it finds into a buffer of its own
+	PrepareWorkerBuffers();
+	jobs.ParallelFor((int)(last - first), [&](int begin, int end, int worker) {
+		std::vector<CollisionDetection::CollisionInfo>& pairs = workerBuffers[worker];
 
-	tree.OperateOnContents([&](std::list < QuadTreeEntry < GameObject*>>& data) {
-		CollisionDetection::CollisionInfo info;
-			for (auto i = data.begin(); i != data.end(); ++i) {
-				for (auto j = std::next(i); j != data.end(); ++j) {
-					// is this pair of items already in the collision set -
-					// if the same pair is in another quadtree node together etc
-					info.a = min((*i).object, (*j).object);
-					info.b = max((*i).object, (*j).object);
-					
-					broadphaseCollisions.insert(info);
-					
-				}
-				
+		for (auto i = first + begin; i != first + end; ++i) {
+			int proxy = (*i)->GetBroadphaseProxy();
+			if (proxy == -1) {
+				continue;
 			}
+			GameObject* object = *i;
+			//Anything touching a sleeping object is found by the awake object's
+			//query, so a settled pile costs nothing here
+			if (object->GetPhysicsObject()->IsAsleep()) {
+				continue;
+			}
+			if (useSweepAndPrune) {
+				gameWorld.QueryStaticObjects(sweepAndPrune.GetBounds(proxy), [&](GameObject* other) {
+					if (CanCollide(object, other)) {
+						pairs.emplace_back(makePair(object, other));
+					}
+				});
+				continue;
+			}
+			const BroadphaseBounds& bounds = broadphaseTree.GetFatBounds(proxy);
+			broadphaseTree.Query(bounds, [&](int otherProxy) {
+				GameObject* other = broadphaseTree.GetObject(otherProxy);
+				//two awake objects will find each other - only keep one of them
+				bool keep = other->GetPhysicsObject()->IsAsleep() || other->GetWorldID() < object->GetWorldID();
+				if (keep && CanCollide(object, other)) {
+					pairs.emplace_back(makePair(object, other));
+				}
+				return true;
 			});
+			gameWorld.QueryStaticObjects(bounds, [&](GameObject* other) {
+				if (CanCollide(object, other)) {
+					pairs.emplace_back(makePair(object, other));
+				}
+			});
+		}
+	}, 32);
+
+	for (auto& pairs : workerBuffers) {
+		broadphaseCollisions.insert(broadphaseCollisions.end(), pairs.begin(), pairs.end());
+	}
 }
 
 /*
 
 The broadphase will now only give us likely collisions, so we can now go through them,
-and work out if they are truly colliding, and if so, add them into the main collision list
+and work out if they are truly colliding, and if so, add them into the main collision list.
+Each worker tests a run of pairs into its own contact buffer, and the buffers are then
+joined back up in worker order. Contact reports, the collision cache and waking up
+sleeping objects aren't thread safe, so they are done afterwards, on the calling thread.
 */
 void PhysicsSystem::NarrowPhase() {
-	for (std::set < CollisionDetection::CollisionInfo >::iterator
-		i = broadphaseCollisions.begin();
-		i != broadphaseCollisions.end(); ++i) {
-		CollisionDetection::CollisionInfo info = *i;
-		if (CollisionDetection::ObjectIntersection(info.a, info.b, info)) {
-			info.framesLeft = numCollisionFrames;
-			ImpulseResolveCollision(*info.a, *info.b, info.point);
-			allCollisions.insert(info); // insert into our main set
-			
+	PROFILE_ZONE("PhysicsSystem::NarrowPhase");
+	int pairCount = (int)broadphaseCollisions.size();
+
+	//The pairs are sorted by what kind of volumes they have, so that every
+	//run of pairs can be handed to the kernel for that kind all at once
+	pairTypes.resize(pairCount);
+	pairTypeStarts.assign(CollisionDetection::PAIR_TYPE_COUNT + 1, 0);
+	for (int i = 0; i < pairCount; ++i) {
+		pairTypes[i] = CollisionDetection::GetPairType(broadphaseCollisions[i].a, broadphaseCollisions[i].b);
+		if (pairTypes[i] >= 0) {
+			pairTypeStarts[pairTypes[i] + 1]++;
 		}
-		
+	}
+	for (int i = 0; i < CollisionDetection::PAIR_TYPE_COUNT; ++i) {
+		pairTypeStarts[i + 1] += pairTypeStarts[i];
+	}
+	int sortedCount = pairTypeStarts[CollisionDetection::PAIR_TYPE_COUNT];
+	sortedPairs.resize(sortedCount);
+	pairTypeOffsets.assign(pairTypeStarts.begin(), pairTypeStarts.end() - 1);
+	for (int i = 0; i < pairCount; ++i) {
+		if (pairTypes[i] >= 0) {
+			sortedPairs[pairTypeOffsets[pairTypes[i]]++] = broadphaseCollisions[i];
+		}
+	}
+	pairAxes.resize(sortedCount);
+
+	PrepareWorkerBuffers();
+	jobs.ParallelFor(sortedCount, [&](int begin, int end, int worker) {
+		std::vector<CollisionDetection::CollisionInfo>& found = workerBuffers[worker];
+
+		for (int i = begin; i < end; ++i) {
+			pairAxes[i] = Vector3();
+			separatingAxes.Find(sortedPairs[i].a, sortedPairs[i].b, pairAxes[i]);
+		}
+		for (int type = 0; type < CollisionDetection::PAIR_TYPE_COUNT; ++type) {
+			int first	= pairTypeStarts[type] > begin ? pairTypeStarts[type] : begin;
+			int last	= pairTypeStarts[type + 1] < end ? pairTypeStarts[type + 1] : end;
+			if (first >= last) {
+				continue;
+			}
+			size_t foundBefore = found.size();
+			CollisionDetection::BatchIntersection(type, &sortedPairs[first], &pairAxes[first], last - first, found);
+			for (size_t j = foundBefore; j < found.size(); ++j) {
+				found[j].framesLeft = numCollisionFrames;
+			}
+		}
+	}, 32);
+
+	//Only pairs that went through GJK will have an axis to remember
+	separatingAxes.Clear();
+	for (int i = 0; i < sortedCount; ++i) {
+		if (pairAxes[i] != Vector3()) {
+			separatingAxes.Insert(sortedPairs[i].a, sortedPairs[i].b, pairAxes[i]);
+		}
+	}
+
+	contacts.clear();
+	for (auto& found : workerBuffers) {
+		contacts.insert(contacts.end(), found.begin(), found.end());
+	}
+
+	//Triggers only need the cache, for their begin and end callbacks, so
+	//they're taken out of the contacts to be solved
+	contactPairs.clear();
+	int solvedCount = 0;
+	for (int i = 0; i < (int)contacts.size(); ++i) {
+		CollisionDetection::CollisionInfo& info = contacts[i];
+		ReportContact(info.a, info.b);
+
+		if (info.a->IsTrigger() || info.b->IsTrigger()) {
+			allCollisions.Insert(info);
+			continue;
+		}
+		//Something awake has run into something sleeping, so wake it up
+		info.a->GetPhysicsObject()->WakeUp();
+		info.b->GetPhysicsObject()->WakeUp();
+
+		//Points still touching from last step start off with the impulses they had then
+		CollisionPair* previous = allCollisions.Find(info.a, info.b);
+		if (previous) {
+			ContactSolver::MatchImpulses(info, previous->info);
+		}
+		CollisionPair& pair = allCollisions.Insert(info); // insert into our main cache
+		contactPairs.emplace_back(allCollisions.GetPairIndex(pair));
+		contacts[solvedCount++] = info;
+	}
+	contacts.resize(solvedCount);
+}
+
+/*
+Contacts are grouped into islands of bodies that can push on each other, and
+whole islands are handed out to the workers. Each pass solves every island's
+contacts once, and then every constraint once through the constraint solver,
+which splits its batches up by colour instead. Constraints still join
+islands together, so that anything tied together sleeps together.
+Constraints between objects that are all asleep or static are skipped.
+
+The contacts are solved in place in the collision cache, so whatever
+impulses they finish with are there to warm start them next step.
+*/
+void PhysicsSystem::SolveIslands(float dt, int iterations) {
+	PROFILE_ZONE("PhysicsSystem::SolveIslands");
+	float constraintDt = dt / (float)iterations;
+
+	auto bodyIndex = [](GameObject* o) {
+		return (o && o->GetPhysicsObject()) ? o->GetPhysicsObject()->GetBodyIndex() : -1;
+	};
+	auto isAwake = [&](GameObject* o) {
+		return bodyIndex(o) != -1 && !o->GetPhysicsObject()->IsAsleep();
+	};
+
+	std::vector<Constraint*>::const_iterator first;
+	std::vector<Constraint*>::const_iterator last;
+	gameWorld.GetConstraintIterators(first, last);
+
+	//Waking bodies moves them around in the body store, so that's all done
+	//before any of the islands are worked out
+	islandConstraints.clear();
+	for (auto i = first; i != last; ++i) {
+		GameObject* a = (*i)->GetObjectA();
+		GameObject* b = (*i)->GetObjectB();
+		if (!a && !b) {
+			islandConstraints.emplace_back(*i); //can't tell, so always run it
+			continue;
+		}
+		if (!isAwake(a) && !isAwake(b)) {
+			continue; //nothing here can move
+		}
+		if (a && a->GetPhysicsObject()) {
+			a->GetPhysicsObject()->WakeUp();
+		}
+		if (b && b->GetPhysicsObject()) {
+			b->GetPhysicsObject()->WakeUp();
+		}
+		islandConstraints.emplace_back(*i);
+	}
+
+	islands.Reset(bodies.GetBodyCount());
+	for (const CollisionDetection::CollisionInfo& info : contacts) {
+		islands.AddItem(bodyIndex(info.a), bodyIndex(info.b));
+	}
+	constraintSolver.Clear();
+	for (Constraint* c : islandConstraints) {
+		islands.AddItem(bodyIndex(c->GetObjectA()), bodyIndex(c->GetObjectB()));
+		constraintSolver.AddConstraint(c);
+	}
+	islands.Build();
+
+	int contactCount = (int)contacts.size();
+
+	contactSolver.SetContactCount(contactCount);
+	jobs.ParallelFor(contactCount, [&](int begin, int end, int) {
+		for (int i = begin; i < end; ++i) {
+			contactSolver.PrepareContact(i, allCollisions.GetPair(contactPairs[i]).info, dt);
+		}
+	}, 32);
+
+	constraintSolver.Prepare(bodies, constraintDt);
+
+	//contacts were added first, so always come before the constraints
+	auto islandContacts = [&](int island, auto func) {
+		const int*	items		= islands.GetItems(island);
+		int			itemCount	= islands.GetItemCount(island);
+		for (int k = 0; k < itemCount && items[k] < contactCount; ++k) {
+			func(items[k]);
+		}
+	};
+
+	jobs.ParallelFor(islands.GetIslandCount(), [&](int begin, int end, int) {
+		for (int island = begin; island < end; ++island) {
+			islandContacts(island, [&](int i) { contactSolver.WarmStart(i); });
+		}
+	}, 8);
+
+	for (int n = 0; n < iterations; ++n) {
+		jobs.ParallelFor(islands.GetIslandCount(), [&](int begin, int end, int) {
+			for (int island = begin; island < end; ++island) {
+				islandContacts(island, [&](int i) { contactSolver.SolveContact(i); });
+			}
+		}, 8);
+		UpdateConstraints(constraintDt);
+	}
+
+	jobs.ParallelFor(islands.GetIslandCount(), [&](int begin, int end, int) {
+		for (int island = begin; island < end; ++island) {
+			islandContacts(island, [&](int i) { contactSolver.StoreImpulses(i); });
+		}
+	}, 8);
+}
+
+/*
+Runs at the end of every step, using the islands the solver just built - so
+anything touching, or tied together by a constraint, goes to sleep together or
+not at all. Each body counts how many steps in a row it has been moving slower
+than the sleep thresholds, and an island sleeps once its least rested body has
+been still for long enough. Bodies that aren't touching anything get judged on
+their own.
+*/
+void PhysicsSystem::UpdateSleeping() {
+	PROFILE_ZONE("PhysicsSystem::UpdateSleeping");
+	int awakeCount	= bodies.GetAwakeCount();
+	int islandCount = islands.GetIslandCount();
+
+	float linearSqr		= sleepLinearSpeed * sleepLinearSpeed;
+	float angularSqr	= sleepAngularSpeed * sleepAngularSpeed;
+
+	islandRestFrames.assign(islandCount, sleepFrames);
+
+	for (int i = 0; i < awakeCount; ++i) {
+		bool resting =
+			bodies.linearVelocities.Get(i).LengthSquared() < linearSqr &&
+			bodies.angularVelocities.Get(i).LengthSquared() < angularSqr;
+
+		bodies.restFrames[i] = resting ? bodies.restFrames[i] + 1 : 0;
+
+		int island = islands.GetBodyIsland(i);
+		if (island >= 0 && bodies.restFrames[i] < islandRestFrames[island]) {
+			islandRestFrames[island] = bodies.restFrames[i];
+		}
+	}
+
+	//Sleeping a body moves it in the store, so find them all first
+	bodiesToSleep.clear();
+	for (int i = 0; i < awakeCount; ++i) {
+		int island	= islands.GetBodyIsland(i);
+		int rested	= island >= 0 ? islandRestFrames[island] : bodies.restFrames[i];
+		if (rested >= sleepFrames) {
+			int group = sleepGroupCounter + (island >= 0 ? island : islandCount + i);
+			bodiesToSleep.emplace_back(bodies.owners[i], group);
+		}
+	}
+	for (auto& b : bodiesToSleep) {
+		bodies.SleepBody(b.first->GetBodyIndex(), b.second);
+	}
+
+	//Old groups can't be told apart from new ones once this wraps, which
+	//at worst means a few extra bodies get woken up together
+	sleepGroupCounter += islandCount + awakeCount;
+	if (sleepGroupCounter > (1 << 30)) {
+		sleepGroupCounter = 0;
 	}
 }
 
@@ -334,41 +1005,28 @@ based on any forces that have been accumulated in the objects during
 the course of the previous game frame.
 */
 void PhysicsSystem::IntegrateAccel(float dt) {
-	std::vector < GameObject* >::const_iterator first;
-	std::vector < GameObject* >::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
-	
-		for (auto i = first; i != last; ++i) {
-		PhysicsObject * object = (*i)->GetPhysicsObject(); //遍历每个GameObject，如果它具有PhysicsObject
-		if (object == nullptr) {
-			continue; // No physics object for this GameObject !
-			
-		}
-		float inverseMass = object->GetInverseMass();
-		
-		Vector3 linearVel = object->GetLinearVelocity();
-		Vector3 force = object->GetForce();
-		Vector3 accel = force * inverseMass; //加速度
-		//重力
-			if (applyGravity && inverseMass > 0) {
-			accel += gravity; // don 't move infinitely heavy things
-			
-		}
-			linearVel += accel * dt; // integrate accel !
-		object->SetLinearVelocity(linearVel);
-
-		// Angular stuff
-		Vector3 torque = object->GetTorque();
-		Vector3 angVel = object->GetAngularVelocity();
-		
-			object->UpdateInertiaTensor(); // update tensor vs orientation
-		
-			Vector3 angAccel = object->GetInertiaTensor() * torque; //对象的惯性张量来转换加速度
-		
-			angVel += angAccel * dt; // integrate angular accel !
-		object->SetAngularVelocity(angVel);
-		
-		
+	PROFILE_ZONE("PhysicsSystem::IntegrateAccel");
+	int bodyCount = bodies.GetAwakeCount(); //sleeping bodies come after these, and are left alone
+
+	PhysicsIntegrator::IntegrateLinearAccel(bodies, gravity, applyGravity, dt);
+
+	// Angular stuff
+	bodies.UpdateInertiaTensors(); // update tensor vs orientation
+
+	const float* tx = bodies.torques.x.data();
+	const float* ty = bodies.torques.y.data();
+	const float* tz = bodies.torques.z.data();
+	float* wx = bodies.angularVelocities.x.data();
+	float* wy = bodies.angularVelocities.y.data();
+	float* wz = bodies.angularVelocities.z.data();
+
+	for (int i = 0; i < bodyCount; ++i) {
+		//对象的惯性张量来转换加速度
+		Vector3 angAccel = bodies.inverseInertiaTensors[i] * Vector3(tx[i], ty[i], tz[i]);
+
+		wx[i] += angAccel.x * dt; // integrate angular accel !
+		wy[i] += angAccel.y * dt;
+		wz[i] += angAccel.z * dt;
 	}
 }
 /*
@@ -376,42 +1034,112 @@ This function integrates linear and angular velocity into
 position and orientation. It may be called multiple times
 throughout a physics update, to slowly move the objects through
 the world, looking for collisions.
+
+Only bodies that actually moved get their new position and
+orientation written back out to their transform.
 */
 void PhysicsSystem::IntegrateVelocity(float dt) {
-	std::vector < GameObject* >::const_iterator first;
-	std::vector < GameObject* >::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
+	PROFILE_ZONE("PhysicsSystem::IntegrateVelocity");
 	float dampingFactor = 1.0f - 0.95f;
 	float frameDamping = powf(dampingFactor, dt);
-	
-		for (auto i = first; i != last; ++i) {
-		PhysicsObject * object = (*i)->GetPhysicsObject();
-		if (object == nullptr) {
+	int bodyCount = bodies.GetAwakeCount();
+
+	PhysicsIntegrator::IntegrateVelocity(bodies, frameDamping, dt);
+
+	const float* vx = bodies.linearVelocities.x.data();
+	const float* vy = bodies.linearVelocities.y.data();
+	const float* vz = bodies.linearVelocities.z.data();
+	const float* wx = bodies.angularVelocities.x.data();
+	const float* wy = bodies.angularVelocities.y.data();
+	const float* wz = bodies.angularVelocities.z.data();
+
+	//Damping never quite reaches zero, so anything still has a velocity moved
+	for (int i = 0; i < bodyCount; ++i) {
+		if (vx[i] != 0.0f || vy[i] != 0.0f || vz[i] != 0.0f ||
+			wx[i] != 0.0f || wy[i] != 0.0f || wz[i] != 0.0f) {
+			bodies.WriteTransform(i);
+		}
+	}
+}
+
+/*
+Bodies that use continuous collision, and moved further this step than the
+given fraction of their size, are swept from where they started the step to
+where they ended up, against everything in the broadphase along the way.
+If they hit something, they're pulled back to just inside it, so that the
+next step's narrowphase finds the contact rather than the body tunnelling
+straight through. Other dynamic objects are taken to be where they ended the
+step, and sort-and-sweep can't be asked what's in a region, so with it only
+static objects are swept against.
+*/
+void PhysicsSystem::ContinuousCollision() {
+	PROFILE_ZONE("PhysicsSystem::ContinuousCollision");
+	const float contactDepth = 0.02f; //a little deeper than the contact solver leaves alone
+
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	gameWorld.GetDynamicObjectIterators(first, last);
+
+	for (auto o = first; o != last; ++o) {
+		PhysicsObject* object = (*o)->GetPhysicsObject();
+		const CollisionVolume* volume = object->GetVolume();
+		int i = object->GetBodyIndex();
+		if (i == -1 || !bodies.IsAwake(i) || !object->UsesContinuousCollision() || !volume || (*o)->IsTrigger()) {
 			continue;
-			
-		}
-		Transform & transform = (*i)->GetTransform();
-		// Position Stuff
-			Vector3 position = transform.GetLocalPosition();
-		Vector3 linearVel = object->GetLinearVelocity();
-		position += linearVel * dt; //获取速度
-		transform.SetLocalPosition(position);
-		// Linear Damping
-			linearVel = linearVel * frameDamping;
-		object->SetLinearVelocity(linearVel);
-
-		// Orientation Stuff
-		Quaternion orientation = transform.GetLocalOrientation();
-		Vector3 angVel = object->GetAngularVelocity();
-		
-		orientation = orientation +(Quaternion(angVel * dt * 0.5f, 0.0f) * orientation);
-		orientation.Normalise();
-		
-			transform.SetLocalOrientation(orientation);
-		
-			// Damp the angular velocity too
-			angVel = angVel * frameDamping; //阻尼
-		object->SetAngularVelocity(angVel);
+		}
+		Vector3 start	= bodies.previousPositions.Get(i);
+		Vector3 end		= bodies.positions.Get(i);
+		Vector3 path	= end - start;
+
+		Vector3 halfSize;
+		if (volume->type == VolumeType::Sphere) {
+			float r = ((const SphereVolume*)volume)->GetRadius();
+			halfSize = Vector3(r, r, r);
+		}
+		else if (volume->type == VolumeType::AABB) {
+			halfSize = ((const AABBVolume*)volume)->GetHalfDimensions();
+		}
+		else {
+			continue;
+		}
+		float size = halfSize.x < halfSize.y ? halfSize.x : halfSize.y;
+		size = halfSize.z < size ? halfSize.z : size;
+
+		if (path.LengthSquared() <= (continuousThreshold * size) * (continuousThreshold * size)) {
+			continue;
+		}
+
+		float firstImpact = 1.0f;
+		auto sweep = [&](GameObject* other) {
+			const CollisionVolume* otherVolume = other->GetBoundingVolume();
+			if (other->GetPhysicsObject() == object || !otherVolume || other->IsTrigger() || !CanCollide(*o, other)) {
+				return;
+			}
+			float impact;
+			if (CollisionDetection::SweptVolumeTest(*volume, start, end, *otherVolume, other->GetConstTransform(), impact) &&
+				impact < firstImpact) {
+				firstImpact = impact;
+			}
+		};
+
+		BroadphaseBounds swept = BroadphaseBounds::Merge(BroadphaseBounds(start, halfSize), BroadphaseBounds(end, halfSize));
+
+		gameWorld.QueryStaticObjects(swept, sweep);
+		if (!useSweepAndPrune) {
+			broadphaseTree.Query(swept, [&](int proxy) {
+				sweep(broadphaseTree.GetObject(proxy));
+				return true;
+			});
+		}
+
+		if (firstImpact < 1.0f) {
+			float pathLength	= path.Length();
+			float travelled		= firstImpact * pathLength + contactDepth;
+			travelled = travelled < pathLength ? travelled : pathLength;
+
+			bodies.positions.Set(i, start + path * (travelled / pathLength));
+			bodies.WriteTransform(i);
+		}
 	}
 }
 
@@ -421,14 +1149,7 @@ clear out any accumulated forces, ready to receive new
 ones in the next 'game' frame.
 */
 void PhysicsSystem::ClearForces() {
-	std::vector<GameObject*>::const_iterator first;
-	std::vector<GameObject*>::const_iterator last;
-	gameWorld.GetObjectIterators(first, last);
-
-	for (auto i = first; i != last; ++i) {
-		//Clear our object's forces for the next frame
-		(*i)->GetPhysicsObject()->ClearForces();
-	}
+	bodies.ClearForces();
 }
 
 
@@ -438,13 +1159,10 @@ As part of the final physics tutorials, we add in the ability
 to constrain objects based on some extra calculation, allowing
 us to model springs and ropes etc. 
 
+This is the only place constraints get solved - one pass over whatever
+the constraint solver was last prepared with.
+
 */
 void PhysicsSystem::UpdateConstraints(float dt) {
-	std::vector<Constraint*>::const_iterator first;
-	std::vector<Constraint*>::const_iterator last;
-	gameWorld.GetConstraintIterators(first, last);
-
-	for (auto i = first; i != last; ++i) {
-		(*i)->UpdateConstraint(dt);
-	}
+	constraintSolver.Solve(bodies, jobs, dt);
 }
\ No newline at end of file
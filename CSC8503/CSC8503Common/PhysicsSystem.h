@@ -1,9 +1,40 @@
 #pragma once
 #include "../CSC8503Common/GameWorld.h"
-#include <set>
+#include "DynamicAABBTree.h"
+#include "SweepAndPrune.h"
+#include "CollisionPairCache.h"
+#include "PhysicsBodyStore.h"
+#include "JobSystem.h"
+#include "SimulationIslands.h"
+#include "ContactSolver.h"
+#include "ConstraintSolver.h"
+#include "SeparatingAxisCache.h"
+#include "CollisionEvent.h"
 
 namespace NCL {
 	namespace CSC8503 {
+		/*
+		What the last Update spent its time on, in seconds, added up over
+		every step it took, along with how much work the step was given.
+		The pair and contact counts are those of the last step taken.
+		*/
+		struct PhysicsStepStats {
+			int		steps				= 0;
+			float	integrateTime		= 0.0f;
+			float	broadphaseTime		= 0.0f;
+			float	narrowphaseTime		= 0.0f;
+			float	solveTime			= 0.0f;
+			float	continuousTime		= 0.0f;
+			float	sleepingTime		= 0.0f;
+			float	collisionListTime	= 0.0f;
+			float	totalTime			= 0.0f;
+
+			int		broadphasePairs		= 0;	//pairs whose bounds overlapped
+			int		contacts			= 0;	//pairs the narrowphase found touching
+			int		trackedPairs		= 0;	//pairs held in the collision list
+			int		awakeBodies			= 0;
+		};
+
 		class PhysicsSystem	{
 		public:
 			PhysicsSystem(GameWorld& g);
@@ -23,40 +54,214 @@ namespace NCL {
 
 			void SetGravity(const Vector3& g);
 
-			bool goose_water_detection = false;
-			bool apple_goose_detection = false;
-			bool apple_island_detection = false;
+			//Physics always steps by exactly this much, however long frames take
+			void SetFixedTimestep(float dt) {
+				fixedDeltaTime = dt;
+			}
+
+			float GetFixedTimestep() const {
+				return fixedDeltaTime;
+			}
+
+			//The most steps a single Update will run before giving up on catching up
+			void SetMaxSubsteps(int steps) {
+				maxSubsteps = steps;
+			}
+
+			//How far between the last two steps the render transforms were placed
+			float GetInterpolationAlpha() const {
+				return interpolationAlpha;
+			}
+
+			//Swaps the broadphase between the AABB tree and sort-and-sweep
+			void UseSweepAndPrune(bool state);
+
+			//Without the broadphase, every pair of objects is tested each step and no islands are solved
+			void UseBroadPhase(bool state) {
+				useBroadPhase = state;
+				UpdateRaycastFunc();
+			}
+
+			//How many times each step's contacts and constraints are solved over
+			void SetSolverIterations(int iterations) {
+				solverIterations = iterations;
+			}
+
+			//How many threads (including the caller) share the work of each step
+			void SetWorkerCount(int count);
+
+			int GetWorkerCount() const {
+				return jobs.GetWorkerCount();
+			}
+
+			//Lets other systems (such as batched raycasts) share the physics workers between steps
+			JobSystem& GetJobSystem() {
+				return jobs;
+			}
+
+			//Islands whose bodies all stay under both speeds for the given
+			//number of steps are put to sleep until something disturbs them
+			void UseSleeping(bool state);
+
+			void SetSleepThresholds(float linearSpeed, float angularSpeed) {
+				sleepLinearSpeed	= linearSpeed;
+				sleepAngularSpeed	= angularSpeed;
+			}
+
+			void SetSleepFrames(int frames) {
+				sleepFrames = frames;
+			}
+
+			int GetAwakeBodyCount() const {
+				return bodies.GetAwakeCount();
+			}
+
+			int GetSleepingBodyCount() const {
+				return bodies.GetBodyCount() - bodies.GetAwakeCount();
+			}
+
+			//Objects using continuous collision are only swept once they move
+			//further in a step than this fraction of their smallest half size
+			void SetContinuousThreshold(float fraction) {
+				continuousThreshold = fraction;
+			}
+
+			/*
+			Pairs of objects whose collision layers (see GameObject::SetCollisionLayer)
+			don't collide are dropped as the broadphase finds them, before any
+			narrowphase test. Every layer collides with every other to begin with.
+			*/
+			void SetLayerCollisions(int layerA, int layerB, bool state);
+
+			bool LayersCollide(int layerA, int layerB) const {
+				return (layerCollisions[layerA] & (1u << layerB)) != 0;
+			}
+
+			/*
+			Pairs found touching whose layers are set to report contacts raise a
+			contact event every step they stay touching - triggers included. No
+			layers report to begin with.
+			*/
+			void SetLayerReports(int layerA, int layerB, bool state);
+
+			/*
+			Every begin, stay, end and contact event from the last Update, in the order
+			they happened. Events whose objects have since been removed from the
+			world are left in place, with both objects set to nullptr.
+			*/
+			const std::vector<CollisionEvent>& GetCollisionEvents() const {
+				return collisionEvents;
+			}
+
+			int GetCollisionEventCount(CollisionEventType type) const {
+				return eventCounts[(int)type];
+			}
+
+			//Calls OnCollisionBegin / OnCollisionEnd for the last Update's events involving the given layers
+			void DispatchCollisionEvents(unsigned int layerMask = ~0u);
+
+			const PhysicsStepStats& GetStepStats() const {
+				return stepStats;
+			}
 
 		protected:
+			bool CanCollide(const GameObject* a, const GameObject* b) const {
+				return (layerCollisions[a->GetCollisionLayer()] & b->GetCollisionLayerMask()) != 0;
+			}
+
+			void ReportContact(GameObject* a, GameObject* b) {
+				if (layerReports[a->GetCollisionLayer()] & b->GetCollisionLayerMask()) {
+					AddCollisionEvent(a, b, CollisionEventType::Contact);
+				}
+			}
+
 			void BasicCollisionDetection();
 			void BroadPhase();
 			void NarrowPhase();
+			void SolveIslands(float dt, int iterations);
+			void UpdateSleeping();
+			void PrepareWorkerBuffers();
 
 			void ClearForces();
 
 			void IntegrateAccel(float dt);
 			void IntegrateVelocity(float dt);
+			void ContinuousCollision();
 
 			void UpdateConstraints(float dt);
 
 			void UpdateCollisionList();
+			void AddCollisionEvent(GameObject* a, GameObject* b, CollisionEventType type);
+			void ClearCollisionEvents();
 			void UpdateObjectAABBs();
 
-			void ImpulseResolveCollision(GameObject& a , GameObject&b, CollisionDetection::ContactPoint& p) const;
+			void AddToPhysics(GameObject* o);
+			void RemoveFromPhysics(GameObject* o);
+
+			void AddToBroadPhase(GameObject* o);
+			void RemoveFromBroadPhase(GameObject* o);
+			void FlushRemovedObjects();
+			void UpdateRaycastFunc();
+			void RefitMovedProxies();
+
+			void TestCollision(GameObject* a, GameObject* b);
+
+			void ImpulseResolveCollision(GameObject& a , GameObject&b, CollisionDetection::ContactPoint& p);
 
 			GameWorld& gameWorld;
 
+			PhysicsBodyStore bodies;
+
 			bool	applyGravity;
 			Vector3 gravity;
 			float	dTOffset;
 			float	globalDamping;
-			float	frameDT;
+			float	interpolationAlpha;
+			float	fixedDeltaTime	= 1.0f / 120.0f;
+			int		maxSubsteps		= 8;
 
-			std::set<CollisionDetection::CollisionInfo> allCollisions;
-			std::set<CollisionDetection::CollisionInfo>		broadphaseCollisions;
-			std::vector<CollisionDetection::CollisionInfo>	broadphaseCollisionsVec;
+			CollisionPairCache								allCollisions;
+			std::vector<CollisionDetection::CollisionInfo>	broadphaseCollisions;
+			std::vector<CollisionDetection::CollisionInfo>	contacts;
+			std::vector<int>								contactPairs;	//where each contact is in allCollisions
+			std::vector<CollisionDetection::CollisionInfo>	sortedPairs;	//broadphase pairs, grouped by pair type
+			std::vector<int>								pairTypes;
+			std::vector<int>								pairTypeStarts;
+			std::vector<int>								pairTypeOffsets;
+			std::vector<Vector3>							pairAxes;		//separating axis per sorted pair
+			SeparatingAxisCache								separatingAxes;
+			ContactSolver	contactSolver;
+			int				solverIterations = 4;
+			float			continuousThreshold = 0.5f;
 			bool useBroadPhase		= true;
+			bool useSweepAndPrune	= false;
 			int numCollisionFrames	= 5;
+
+			unsigned int	layerCollisions[32];	//a bit per layer each layer collides with
+			unsigned int	layerReports[32];
+
+			std::vector<CollisionEvent>	collisionEvents;
+			std::vector<GameObject*>	removedObjects;	//still to be taken out of the pair cache and events
+			int							eventCounts[4];	//per CollisionEventType, since the last Update began
+
+			PhysicsStepStats	stepStats;
+
+			DynamicAABBTree<GameObject*>	broadphaseTree;
+			SweepAndPrune<GameObject*>		sweepAndPrune;
+
+			JobSystem			jobs;
+			SimulationIslands	islands;
+			std::vector<std::vector<CollisionDetection::CollisionInfo>> workerBuffers;
+			std::vector<Constraint*>	islandConstraints;
+			ConstraintSolver			constraintSolver;
+
+			bool	useSleeping		= true;
+			float	sleepLinearSpeed	= 0.5f;
+			float	sleepAngularSpeed	= 0.5f;
+			int		sleepFrames			= 60;
+			int		sleepGroupCounter	= 0;
+			std::vector<int>	islandRestFrames;
+			std::vector<std::pair<PhysicsObject*, int>> bodiesToSleep;
 		};
 	}
 }
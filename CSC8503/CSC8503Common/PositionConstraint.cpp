@@ -12,6 +12,7 @@ PositionConstraint::PositionConstraint(GameObject* a, GameObject* b, float d)
 	objectA		= a;
 	objectB		= b;
 	distance	= d;
+	type		= ConstraintType::Distance;
 }
 
 PositionConstraint::~PositionConstraint()
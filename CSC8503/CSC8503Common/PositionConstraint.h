@@ -12,6 +12,18 @@ namespace NCL {
 
 			void UpdateConstraint(float dt) override;
 
+			GameObject* GetObjectA() const override {
+				return objectA;
+			}
+
+			GameObject* GetObjectB() const override {
+				return objectB;
+			}
+
+			float GetDistance() const {
+				return distance;
+			}
+
 		protected:
 			GameObject* objectA;
 			GameObject* objectB;
@@ -0,0 +1,286 @@
+#include "Profiler.h"
+#include "Debug.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+using namespace NCL;
+using namespace CSC8503;
+
+std::mutex							Profiler::threadsMutex;
+std::vector<Profiler::ThreadEvents*> Profiler::threads;
+int64_t								Profiler::frameStarts[Profiler::maxFrames];
+std::atomic<int>					Profiler::frameCount(0);
+
+static const std::chrono::high_resolution_clock::time_point profilerStart = std::chrono::high_resolution_clock::now();
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Hands the calling thread's buffer back when the thread exits, so that
+		job workers that are stopped and restarted don't keep adding buffers.
+		*/
+		struct ThreadEventsHandle {
+			Profiler::ThreadEvents* events = nullptr;
+
+			~ThreadEventsHandle() {
+				if (events) {
+					Profiler::ReleaseThreadEvents(events);
+				}
+			}
+		};
+	}
+}
+
+static thread_local ThreadEventsHandle threadEvents;
+
+int64_t Profiler::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - profilerStart).count();
+}
+
+Profiler::ThreadEvents* Profiler::GetThreadEvents() {
+	if (threadEvents.events) {
+		return threadEvents.events;
+	}
+	std::lock_guard<std::mutex> lock(threadsMutex);
+
+	ThreadEvents* t = nullptr;
+	for (ThreadEvents* i : threads) {
+		if (!i->inUse) {
+			t = i;
+			break;
+		}
+	}
+	if (!t) {
+		t = new ThreadEvents();
+		t->id = (int)threads.size();
+		t->events.resize(maxEvents);
+		threads.emplace_back(t);
+	}
+	t->name		= "Thread " + std::to_string(t->id);
+	t->inUse	= true;
+	t->depth	= 0;
+	t->written.store(0, std::memory_order_relaxed);
+
+	threadEvents.events = t;
+	return t;
+}
+
+void Profiler::ReleaseThreadEvents(ThreadEvents* t) {
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	t->inUse = false;
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+	ThreadEvents* t = GetThreadEvents();
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	t->name = name;
+}
+
+void Profiler::BeginZone(const char* name) {
+	ThreadEvents* t = GetThreadEvents();
+	if (t->depth < maxDepth) {
+		t->openNames[t->depth]	= name;
+		t->openStarts[t->depth] = Now();
+	}
+	t->depth++;
+}
+
+void Profiler::EndZone() {
+	ThreadEvents* t = GetThreadEvents();
+	if (t->depth == 0) {
+		return;
+	}
+	t->depth--;
+	if (t->depth >= maxDepth) {
+		return;
+	}
+	uint64_t written = t->written.load(std::memory_order_relaxed);
+
+	ZoneEvent& e = t->events[written % maxEvents];
+	e.name	= t->openNames[t->depth];
+	e.start = t->openStarts[t->depth];
+	e.end	= Now();
+	e.depth = t->depth;
+
+	t->written.store(written + 1, std::memory_order_release);
+}
+
+void Profiler::NextFrame() {
+	int frame = frameCount.load(std::memory_order_relaxed);
+	frameStarts[frame % maxFrames] = Now();
+	frameCount.store(frame + 1, std::memory_order_release);
+}
+
+//The events still in the ring, oldest first
+void Profiler::GetEvents(const ThreadEvents& t, std::vector<ZoneEvent>& out) {
+	uint64_t written	= t.written.load(std::memory_order_acquire);
+	uint64_t first		= written > (uint64_t)maxEvents ? written - maxEvents : 0;
+
+	out.clear();
+	out.reserve((size_t)(written - first));
+	for (uint64_t i = first; i < written; ++i) {
+		out.emplace_back(t.events[i % maxEvents]);
+	}
+}
+
+static void WriteJsonString(std::ostream& out, const std::string& text) {
+	out << '"';
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		}
+		else if ((unsigned char)c < 0x20) {
+			out << ' ';
+		}
+		else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename) {
+	std::ofstream file(filename);
+	if (!file) {
+		return false;
+	}
+	file.setf(std::ios::fixed);
+	file.precision(3);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separator = [&]() {
+		file << (first ? "" : ",\n");
+		first = false;
+	};
+
+	std::vector<ZoneEvent> events;
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (ThreadEvents* t : threads) {
+		separator();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->id << ",\"args\":{\"name\":";
+		WriteJsonString(file, t->name);
+		file << "}}";
+
+		GetEvents(*t, events);
+		for (const ZoneEvent& e : events) {
+			separator();
+			file << "{\"name\":";
+			WriteJsonString(file, e.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << t->id
+				<< ",\"ts\":" << e.start / 1000.0
+				<< ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+		}
+	}
+	int frames		= frameCount.load(std::memory_order_acquire);
+	int firstFrame	= frames > maxFrames ? frames - maxFrames : 0;
+	for (int i = firstFrame; i < frames; ++i) {
+		separator();
+		file << "{\"name\":\"Frame " << i << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+			<< frameStarts[i % maxFrames] / 1000.0 << "}";
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
+
+static std::string FormatTime(int64_t nanoseconds) {
+	std::ostringstream out;
+	out.setf(std::ios::fixed);
+	out.precision(2);
+	out << nanoseconds / 1000000.0 << "ms";
+	return out.str();
+}
+
+void Profiler::PrintSummary(const Vector2& position, float lineHeight) {
+	int frames = frameCount.load(std::memory_order_acquire);
+	if (frames < 2) {
+		return;
+	}
+	int64_t frameStart	= frameStarts[(frames - 2) % maxFrames];
+	int64_t frameEnd	= frameStarts[(frames - 1) % maxFrames];
+
+	Vector2 linePos = position;
+	auto printLine = [&](const std::string& text) {
+		Debug::Print(text, linePos);
+		linePos.y -= lineHeight;
+	};
+	printLine("Frame time " + FormatTime(frameEnd - frameStart));
+
+	ThreadEvents* current = GetThreadEvents();
+	std::vector<ZoneEvent>		events;
+	std::vector<ZoneSummary>	zones;
+	std::vector<int>			open;	//the zone summary at each depth of the zone being looked at
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (ThreadEvents* t : threads) {
+		GetEvents(*t, events);
+		events.erase(std::remove_if(events.begin(), events.end(), [&](const ZoneEvent& e) {
+			return e.start < frameStart || e.end > frameEnd;
+		}), events.end());
+
+		if (t != current) {
+			int64_t busy = 0;
+			for (const ZoneEvent& e : events) {
+				busy += e.depth == 0 ? e.end - e.start : 0;
+			}
+			if (busy > 0) {
+				printLine(t->name + " busy " + FormatTime(busy));
+			}
+			continue;
+		}
+		//Parents start no later than their children, and are shallower
+		std::sort(events.begin(), events.end(), [](const ZoneEvent& a, const ZoneEvent& b) {
+			return a.start != b.start ? a.start < b.start : a.depth < b.depth;
+		});
+		zones.clear();
+		open.clear();
+		for (const ZoneEvent& e : events) {
+			int depth	= e.depth < (int)open.size() ? e.depth : (int)open.size();
+			int parent	= depth > 0 ? open[depth - 1] : -1;
+
+			int zone = -1;
+			for (int i = 0; i < (int)zones.size(); ++i) {
+				if (zones[i].parent == parent && zones[i].name == e.name) {
+					zone = i;
+					break;
+				}
+			}
+			if (zone < 0) {
+				zone = (int)zones.size();
+				zones.push_back({ e.name, parent, depth, 0, 0 });
+			}
+			zones[zone].calls++;
+			zones[zone].time += e.end - e.start;
+
+			open.resize(depth);
+			open.emplace_back(zone);
+		}
+		//Each zone is listed under its parent, in the order they were first seen
+		std::vector<int> stack;
+		for (int i = (int)zones.size() - 1; i >= 0; --i) {
+			if (zones[i].parent < 0) {
+				stack.emplace_back(i);
+			}
+		}
+		while (!stack.empty()) {
+			int i = stack.back();
+			stack.pop_back();
+
+			std::string line(zones[i].depth * 2, ' ');
+			line += std::string(zones[i].name) + " " + FormatTime(zones[i].time);
+			if (zones[i].calls > 1) {
+				line += " (" + std::to_string(zones[i].calls) + ")";
+			}
+			printLine(line);
+
+			for (int j = (int)zones.size() - 1; j > i; --j) {
+				if (zones[j].parent == i) {
+					stack.emplace_back(j);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "../../Common/Vector2.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+A small scoped zone profiler. PROFILE_ZONE("Name") times everything from
+where it's written to the end of the enclosing block, and zones opened
+inside it are nested under it. Every thread records into its own ring
+buffer, so zones can be opened from job workers without any locking, and
+only the most recent events of each thread are kept.
+
+Zone names are kept as pointers, not copied, so they must be string
+literals (or otherwise live for the life of the program).
+
+With NCL_NO_PROFILER defined, the macros expand to nothing, and the only
+remaining cost is the handful of per-frame calls into Profiler itself.
+*/
+#ifndef NCL_NO_PROFILER
+#define PROFILE_CONCAT_INNER(a, b)	a##b
+#define PROFILE_CONCAT(a, b)		PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name)			NCL::CSC8503::ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name)		NCL::CSC8503::Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#endif
+
+namespace NCL {
+	using namespace Maths;
+	namespace CSC8503 {
+		class Profiler	{
+		public:
+			static void BeginZone(const char* name);
+			static void EndZone();
+
+			//Names the calling thread in traces and summaries
+			static void SetThreadName(const std::string& name);
+
+			//Marks the start of a new frame - called once per frame, from the main thread
+			static void NextFrame();
+
+			/*
+			Writes every event still held in the ring buffers out as a Chrome
+			trace (viewable in chrome://tracing or Perfetto). The buffers are read
+			without stopping anything, so this should be called between frames,
+			when no other thread is recording zones.
+			*/
+			static bool WriteChromeTrace(const std::string& filename);
+
+			/*
+			Prints the zones of the last full frame through Debug::Print, one
+			line per zone and working down the screen from the given position.
+			Zones with the same name under the same parent are added together.
+			The calling thread's zones are shown nested, and every other thread
+			only gets its total busy time.
+			*/
+			static void PrintSummary(const Vector2& position, float lineHeight = 20.0f);
+
+		protected:
+			static const int maxEvents		= 16384;	//per thread
+			static const int maxDepth		= 64;
+			static const int maxFrames		= 1024;
+
+			struct ZoneEvent {
+				const char* name;
+				int64_t		start;	//nanoseconds since the profiler started
+				int64_t		end;
+				int			depth;
+			};
+
+			struct ThreadEvents {
+				std::string				name;
+				int						id;
+				bool					inUse;
+				int						depth;
+				std::atomic<uint64_t>	written;
+				const char*				openNames[maxDepth];
+				int64_t					openStarts[maxDepth];
+				std::vector<ZoneEvent>	events;
+			};
+
+			struct ZoneSummary {
+				const char* name;
+				int			parent;
+				int			depth;
+				int			calls;
+				int64_t		time;
+			};
+
+			static ThreadEvents*	GetThreadEvents();
+			static void				ReleaseThreadEvents(ThreadEvents* t);
+			static int64_t			Now();
+			static void				GetEvents(const ThreadEvents& t, std::vector<ZoneEvent>& out);
+
+			static std::mutex					threadsMutex;
+			static std::vector<ThreadEvents*>	threads;
+
+			static int64_t			frameStarts[maxFrames];
+			static std::atomic<int>	frameCount;
+
+			friend struct ThreadEventsHandle;
+		};
+
+		class ProfileZone	{
+		public:
+			ProfileZone(const char* name) {
+				Profiler::BeginZone(name);
+			}
+			~ProfileZone() {
+				Profiler::EndZone();
+			}
+		};
+	}
+}
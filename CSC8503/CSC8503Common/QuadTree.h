@@ -1,6 +1,7 @@
 #pragma once
 #include "../../Common/Vector2.h"
 #include "Debug.h"
+#include "CollisionDetection.h"
 #include <list>
 #include <functional>
 
@@ -2,6 +2,8 @@
 #include "../../Common/Vector3.h"
 #include "../../Common/Plane.h"
 
+#include <cfloat>
+
 namespace NCL {
 	namespace Maths {
 		struct RayCollision {
@@ -3,6 +3,7 @@
 #include "../../Common/TextureBase.h"
 #include "../../Common/ShaderBase.h"
 #include "../../Common/Vector4.h"
+#include "BlockPool.h"
 
 namespace NCL {
 	using namespace NCL::Rendering;
@@ -12,7 +13,7 @@ namespace NCL {
 		class Transform;
 		using namespace Maths;
 
-		class RenderObject
+		class RenderObject : public PooledAllocation<RenderObject>
 		{
 		public:
 			RenderObject(Transform* parentTransform, MeshGeometry* mesh, TextureBase* tex, ShaderBase* shader);
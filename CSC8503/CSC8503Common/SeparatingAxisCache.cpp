@@ -0,0 +1,79 @@
+#include "SeparatingAxisCache.h"
+#include "CollisionPairCache.h"
+#include "GameObject.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+static size_t HashPairKey(uint64_t key) {
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (size_t)key;
+}
+
+SeparatingAxisCache::SeparatingAxisCache()	{
+	keys.resize(64);
+	axes.resize(64);
+	used.assign(64, false);
+	count = 0;
+}
+
+SeparatingAxisCache::~SeparatingAxisCache()	{
+}
+
+void SeparatingAxisCache::Clear() {
+	used.assign(used.size(), false);
+	count = 0;
+}
+
+/*
+The table only ever grows between Clears, so it's simply rebuilt at twice the
+size whenever it would get more than half full.
+*/
+void SeparatingAxisCache::Insert(const GameObject* a, const GameObject* b, const Vector3& axis) {
+	if ((size_t)(count + 1) * 2 > used.size()) {
+		std::vector<uint64_t>	oldKeys	= keys;
+		std::vector<Vector3>	oldAxes	= axes;
+		std::vector<bool>		oldUsed	= used;
+
+		keys.resize(used.size() * 2);
+		axes.resize(used.size() * 2);
+		used.assign(used.size() * 2, false);
+
+		for (size_t i = 0; i < oldUsed.size(); ++i) {
+			if (oldUsed[i]) {
+				int slot	= FindSlot(oldKeys[i]);
+				keys[slot]	= oldKeys[i];
+				axes[slot]	= oldAxes[i];
+				used[slot]	= true;
+			}
+		}
+	}
+	uint64_t key	= CollisionPairCache::GetPairKey(a, b);
+	int slot		= FindSlot(key);
+	if (!used[slot]) {
+		count++;
+	}
+	keys[slot] = key;
+	axes[slot] = a->GetWorldID() > b->GetWorldID() ? -axis : axis;
+	used[slot] = true;
+}
+
+bool SeparatingAxisCache::Find(const GameObject* a, const GameObject* b, Vector3& axis) const {
+	int slot = FindSlot(CollisionPairCache::GetPairKey(a, b));
+	if (!used[slot]) {
+		return false;
+	}
+	axis = a->GetWorldID() > b->GetWorldID() ? -axes[slot] : axes[slot];
+	return true;
+}
+
+int SeparatingAxisCache::FindSlot(uint64_t key) const {
+	size_t mask = used.size() - 1;
+	size_t slot = HashPairKey(key) & mask;
+	while (used[slot] && keys[slot] != key) {
+		slot = (slot + 1) & mask;
+	}
+	return (int)slot;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../../Common/Vector3.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		class GameObject;
+
+		/*
+		Remembers, for each pair of objects the narrowphase found apart, the
+		direction it found them apart along. It's read from by any number of
+		threads during the narrowphase, and then refilled from scratch once it's
+		over, so pairs that stop being tested are forgotten without any removal.
+		Axes are stored for the lower world ID's object first, and flipped on
+		the way in and out, so a pair can be tested either way round.
+		*/
+		class SeparatingAxisCache	{
+		public:
+			SeparatingAxisCache();
+			~SeparatingAxisCache();
+
+			void Clear();
+			void Insert(const GameObject* a, const GameObject* b, const Vector3& axis);
+
+			//Leaves axis alone if the pair isn't cached
+			bool Find(const GameObject* a, const GameObject* b, Vector3& axis) const;
+
+			int GetCount() const {
+				return count;
+			}
+
+		protected:
+			int FindSlot(uint64_t key) const;
+
+			std::vector<uint64_t>	keys;
+			std::vector<Vector3>	axes;
+			std::vector<bool>		used;
+			int count;
+		};
+	}
+}
@@ -0,0 +1,95 @@
+#include "SimulationIslands.h"
+
+using namespace NCL;
+using namespace CSC8503;
+
+SimulationIslands::SimulationIslands()	{
+	islandStarts.push_back(0);
+}
+
+SimulationIslands::~SimulationIslands()	{
+}
+
+void SimulationIslands::Reset(int bodyCount) {
+	parents.resize(bodyCount);
+	for (int i = 0; i < bodyCount; ++i) {
+		parents[i] = i;
+	}
+	itemBodies.clear();
+	islandStarts.clear();
+	islandStarts.push_back(0);
+	islandItems.clear();
+}
+
+int SimulationIslands::FindRoot(int body) {
+	while (parents[body] != body) {
+		parents[body] = parents[parents[body]]; //Halve the path as we go
+		body = parents[body];
+	}
+	return body;
+}
+
+/*
+The lower index always becomes the root, so the islands come out the same no
+matter what order the links were made in.
+*/
+void SimulationIslands::Join(int bodyA, int bodyB) {
+	int rootA = FindRoot(bodyA);
+	int rootB = FindRoot(bodyB);
+	if (rootA < rootB) {
+		parents[rootB] = rootA;
+	}
+	else if (rootB < rootA) {
+		parents[rootA] = rootB;
+	}
+}
+
+void SimulationIslands::AddItem(int bodyA, int bodyB) {
+	itemBodies.push_back(bodyA);
+	itemBodies.push_back(bodyB);
+
+	if (bodyA >= 0 && bodyB >= 0) {
+		Join(bodyA, bodyB);
+	}
+}
+
+/*
+Islands are numbered in the order their first item was added. An item that
+touches no moving bodies at all can't affect anything else, so it gets an
+island to itself. The items are then sorted into one flat list, with a start
+offset per island, so there's nothing to allocate once the lists have grown.
+*/
+void SimulationIslands::Build() {
+	int itemCount = (int)itemBodies.size() / 2;
+
+	rootIslands.assign(parents.size(), -1);
+	itemIslands.resize(itemCount);
+
+	int islandCount = 0;
+	for (int i = 0; i < itemCount; ++i) {
+		int body = itemBodies[i * 2] >= 0 ? itemBodies[i * 2] : itemBodies[i * 2 + 1];
+		if (body < 0) {
+			itemIslands[i] = islandCount++;
+			continue;
+		}
+		int root = FindRoot(body);
+		if (rootIslands[root] < 0) {
+			rootIslands[root] = islandCount++;
+		}
+		itemIslands[i] = rootIslands[root];
+	}
+
+	islandStarts.assign(islandCount + 1, 0);
+	for (int i = 0; i < itemCount; ++i) {
+		islandStarts[itemIslands[i] + 1]++;
+	}
+	for (int i = 0; i < islandCount; ++i) {
+		islandStarts[i + 1] += islandStarts[i];
+	}
+
+	islandItems.resize(itemCount);
+	islandOffsets.assign(islandStarts.begin(), islandStarts.end() - 1);
+	for (int i = 0; i < itemCount; ++i) {
+		islandItems[islandOffsets[itemIslands[i]]++] = i;
+	}
+}
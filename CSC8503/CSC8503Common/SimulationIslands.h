@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Groups up contacts and constraints into islands - sets that share no
+		moving bodies with any other set - so that each island can be solved
+		on a different thread without any locking.
+
+		Items are added with the body index of each object they act on, or -1
+		for an object that doesn't move (static objects are never written to by
+		the solver, so they never join two islands together). Each island's
+		items keep the order they were added in.
+		*/
+		class SimulationIslands	{
+		public:
+			SimulationIslands();
+			~SimulationIslands();
+
+			void Reset(int bodyCount);
+			void AddItem(int bodyA, int bodyB);
+			void Build();
+
+			int GetIslandCount() const {
+				return (int)islandStarts.size() - 1;
+			}
+
+			int GetItemCount(int island) const {
+				return islandStarts[island + 1] - islandStarts[island];
+			}
+
+			const int* GetItems(int island) const {
+				return &islandItems[islandStarts[island]];
+			}
+
+			//-1 if none of the items added touched this body
+			int GetBodyIsland(int body) {
+				return rootIslands[FindRoot(body)];
+			}
+
+		protected:
+			int		FindRoot(int body);
+			void	Join(int bodyA, int bodyB);
+
+			std::vector<int> parents;
+			std::vector<int> rootIslands;
+			std::vector<int> itemBodies;
+			std::vector<int> itemIslands;
+			std::vector<int> islandStarts;
+			std::vector<int> islandItems;
+			std::vector<int> islandOffsets;
+		};
+	}
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Refers to an entry of a SlotMap. Each slot's generation goes up every
+		time its entry is removed, so a handle kept hold of after its entry has
+		gone no longer matches, even once the slot has been given to a new entry.
+		*/
+		struct SlotHandle {
+			uint32_t index;
+			uint32_t generation;
+
+			SlotHandle() : index(~0u), generation(0) {
+			}
+
+			SlotHandle(uint32_t index, uint32_t generation) : index(index), generation(generation) {
+			}
+
+			bool operator==(const SlotHandle& other) const {
+				return index == other.index && generation == other.generation;
+			}
+
+			bool operator!=(const SlotHandle& other) const {
+				return !(*this == other);
+			}
+		};
+
+		/*
+		Keeps its entries packed together at the front of a plain vector, so
+		they can be iterated over like one, with a table of slots on the side
+		that handles are looked up through. Adding and removing are both
+		constant time - a removed entry has the last entry moved into its
+		place - and freed slots are reused, so nothing needs compacting.
+		*/
+		template<class T>
+		class SlotMap	{
+		public:
+			typedef typename std::vector<T>::const_iterator const_iterator;
+
+			SlotMap() {
+				freeSlot = -1;
+			}
+
+			SlotHandle Insert(const T& value) {
+				int slot = freeSlot;
+				if (slot >= 0) {
+					freeSlot = slots[slot].nextFree;
+				}
+				else {
+					slot = (int)slots.size();
+					slots.emplace_back();
+					slots[slot].generation = 0;
+				}
+				slots[slot].dense		= (int)values.size();
+				slots[slot].nextFree	= -1;
+
+				values.emplace_back(value);
+				denseSlots.emplace_back(slot);
+
+				return SlotHandle((uint32_t)slot, slots[slot].generation);
+			}
+
+			bool Remove(SlotHandle h) {
+				if (!Contains(h)) {
+					return false;
+				}
+				int dense	= slots[h.index].dense;
+				int last	= (int)values.size() - 1;
+				Swap(dense, last);
+
+				values.pop_back();
+				denseSlots.pop_back();
+
+				slots[h.index].generation++;
+				slots[h.index].dense	= -1;
+				slots[h.index].nextFree = freeSlot;
+				freeSlot = (int)h.index;
+				return true;
+			}
+
+			bool Contains(SlotHandle h) const {
+				return h.index < slots.size() && slots[h.index].generation == h.generation && slots[h.index].dense >= 0;
+			}
+
+			//nullptr if the handle's entry has been removed
+			T* Get(SlotHandle h) {
+				return Contains(h) ? &values[slots[h.index].dense] : nullptr;
+			}
+
+			const T* Get(SlotHandle h) const {
+				return Contains(h) ? &values[slots[h.index].dense] : nullptr;
+			}
+
+			//Where an entry currently is in the packed order
+			int GetDenseIndex(SlotHandle h) const {
+				return Contains(h) ? slots[h.index].dense : -1;
+			}
+
+			SlotHandle GetHandle(int dense) const {
+				int slot = denseSlots[dense];
+				return SlotHandle((uint32_t)slot, slots[slot].generation);
+			}
+
+			//Swaps two entries' places in the packed order, leaving their handles alone
+			void Swap(int a, int b) {
+				if (a == b) {
+					return;
+				}
+				std::swap(values[a], values[b]);
+				std::swap(denseSlots[a], denseSlots[b]);
+				slots[denseSlots[a]].dense = a;
+				slots[denseSlots[b]].dense = b;
+			}
+
+			//Removes everything, leaving every handle given out so far stale
+			void Clear() {
+				for (int slot : denseSlots) {
+					slots[slot].generation++;
+					slots[slot].dense		= -1;
+					slots[slot].nextFree	= freeSlot;
+					freeSlot = slot;
+				}
+				values.clear();
+				denseSlots.clear();
+			}
+
+			int GetCount() const {
+				return (int)values.size();
+			}
+
+			T& operator[](int dense) {
+				return values[dense];
+			}
+
+			const T& operator[](int dense) const {
+				return values[dense];
+			}
+
+			const_iterator begin() const {
+				return values.begin();
+			}
+
+			const_iterator end() const {
+				return values.end();
+			}
+
+		protected:
+			struct Slot {
+				uint32_t	generation;
+				int			dense;		//where the entry is in values, or -1 if the slot is free
+				int			nextFree;
+			};
+
+			std::vector<T>		values;
+			std::vector<int>	denseSlots;	//the slot each value belongs to
+			std::vector<Slot>	slots;
+			int					freeSlot;	//the first of the free slots, chained through nextFree
+		};
+	}
+}
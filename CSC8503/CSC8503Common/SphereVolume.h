@@ -5,6 +5,10 @@ namespace NCL {
 	class SphereVolume : CollisionVolume
 	{
 	public:
+		//Taken from the pooled ones in CollisionVolume, which the private inheritance would hide
+		using CollisionVolume::operator new;
+		using CollisionVolume::operator delete;
+
 		SphereVolume(float sphereRadius = 1.0f) {
 			type	= VolumeType::Sphere;
 			radius	= sphereRadius;
@@ -0,0 +1,219 @@
+#pragma once
+#include "DynamicAABBTree.h"
+#include <vector>
+#include <algorithm>
+
+namespace NCL {
+	using namespace NCL::Maths;
+	namespace CSC8503 {
+		template<class T>
+		struct SweepAndPruneProxy {
+			BroadphaseBounds bounds;
+			T		object;
+			bool	inUse;
+			int		endpoints[2];	//where the proxy's start and end are in the endpoint list
+		};
+
+		//Either the start or the end of a proxy's extent along the sweep axis
+		struct SweepEndpoint {
+			float	value;
+			int		proxy;	//-1 once the proxy has been removed
+			bool	isMin;
+		};
+
+		/*
+		Sort-and-sweep broadphase. An array of proxy start/end points along the
+		sweep axis stays sorted from frame to frame. Objects don't move far in a
+		single step, so the array is nearly sorted already, and an insertion sort
+		puts it right again in close to linear time. The sweep axis is whichever
+		one the objects are most spread out on, and if that changes the array is
+		refilled along the new axis and sorted from scratch.
+		*/
+		template<class T>
+		class SweepAndPrune {
+		public:
+			SweepAndPrune() {
+				proxyCount		= 0;
+				sweepAxis		= 0;
+				newEndpoints	= 0;
+			}
+			~SweepAndPrune() {
+			}
+
+			void Clear() {
+				proxies.clear();
+				endpoints.clear();
+				freeIDs.clear();
+				proxyCount		= 0;
+				newEndpoints	= 0;
+			}
+
+			int InsertProxy(T object, const Vector3& pos, const Vector3& halfSize) {
+				int id;
+				if (!freeIDs.empty()) {
+					id = freeIDs.back();
+					freeIDs.pop_back();
+				}
+				else {
+					id = (int)proxies.size();
+					proxies.emplace_back();
+				}
+				SweepAndPruneProxy<T>& p = proxies[id];
+				p.bounds	= BroadphaseBounds(pos, halfSize);
+				p.object	= object;
+				p.inUse		= true;
+
+				//New endpoints go on the end, and get sorted into place next update
+				p.endpoints[0] = (int)endpoints.size();
+				p.endpoints[1] = (int)endpoints.size() + 1;
+				endpoints.push_back({ p.bounds.min[sweepAxis], id, true });
+				endpoints.push_back({ p.bounds.max[sweepAxis], id, false });
+				newEndpoints += 2;
+				proxyCount++;
+				return id;
+			}
+
+			//The proxy's endpoints are only marked here, and taken out next update
+			void RemoveProxy(int proxy) {
+				SweepAndPruneProxy<T>& p = proxies[proxy];
+				endpoints[p.endpoints[0]].proxy = -1;
+				endpoints[p.endpoints[1]].proxy = -1;
+				p.inUse = false;
+				freeIDs.push_back(proxy);
+				proxyCount--;
+			}
+
+			void MoveProxy(int proxy, const Vector3& pos, const Vector3& halfSize) {
+				proxies[proxy].bounds = BroadphaseBounds(pos, halfSize);
+			}
+
+			T& GetObject(int proxy) {
+				return proxies[proxy].object;
+			}
+
+			const BroadphaseBounds& GetBounds(int proxy) const {
+				return proxies[proxy].bounds;
+			}
+
+			int GetProxyCount() const {
+				return proxyCount;
+			}
+
+			/*
+			Picks the axis with the greatest spread of object centres to sweep
+			along, as that is the one that separates the most objects, then
+			refreshes every endpoint from its proxy's current bounds and restores
+			the sorted order.
+			*/
+			void UpdateAxes() {
+				Vector3 sum;
+				Vector3 sumSq;
+				for (const SweepAndPruneProxy<T>& p : proxies) {
+					if (!p.inUse) {
+						continue;
+					}
+					Vector3 centre = (p.bounds.min + p.bounds.max) * 0.5f;
+					sum		+= centre;
+					sumSq	+= centre * centre;
+				}
+				int axis = sweepAxis;
+				if (proxyCount > 0) {
+					Vector3 variance = (sumSq / (float)proxyCount) - ((sum * sum) / (float)(proxyCount * proxyCount));
+					axis = 0;
+					if (variance.y > variance[axis]) {
+						axis = 1;
+					}
+					if (variance.z > variance[axis]) {
+						axis = 2;
+					}
+				}
+				//A new axis, or a big batch of new proxies, is nowhere near sorted
+				bool resort = axis != sweepAxis || newEndpoints * 4 > (int)endpoints.size();
+				sweepAxis		= axis;
+				newEndpoints	= 0;
+
+				int out = 0;
+				for (const SweepEndpoint& e : endpoints) {
+					if (e.proxy == -1) {
+						continue;
+					}
+					const BroadphaseBounds& b = proxies[e.proxy].bounds;
+					endpoints[out] = e;
+					endpoints[out].value = e.isMin ? b.min[sweepAxis] : b.max[sweepAxis];
+					out++;
+				}
+				endpoints.resize(out);
+
+				if (resort) {
+					std::sort(endpoints.begin(), endpoints.end(), SortsBefore);
+				}
+				else {
+					InsertionSort(endpoints);
+				}
+				for (int i = 0; i < (int)endpoints.size(); ++i) {
+					proxies[endpoints[i].proxy].endpoints[endpoints[i].isMin ? 0 : 1] = i;
+				}
+			}
+
+			/*
+			Calls func(a, b) once for every overlapping pair. Call UpdateAxes first!
+			*/
+			template<class F>
+			void FindPairs(F func) {
+				active.clear();
+
+				for (const SweepEndpoint& e : endpoints) {
+					if (e.proxy == -1) {
+						continue;
+					}
+					SweepAndPruneProxy<T>& p = proxies[e.proxy];
+
+					if (!e.isMin) {
+						for (int i = 0; i < (int)active.size(); ++i) {
+							if (active[i] == e.proxy) {
+								active[i] = active.back();
+								active.pop_back();
+								break;
+							}
+						}
+						continue;
+					}
+					for (int other : active) {
+						if (p.bounds.Overlaps(proxies[other].bounds)) {
+							func(p.object, proxies[other].object);
+						}
+					}
+					active.push_back(e.proxy);
+				}
+			}
+
+		protected:
+			//min before max on ties, so touching boxes still get tested
+			static bool SortsBefore(const SweepEndpoint& a, const SweepEndpoint& b) {
+				return a.value < b.value || (a.value == b.value && a.isMin && !b.isMin);
+			}
+
+			static void InsertionSort(std::vector<SweepEndpoint>& list) {
+				for (int i = 1; i < (int)list.size(); ++i) {
+					SweepEndpoint key = list[i];
+					int j = i - 1;
+					while (j >= 0 && SortsBefore(key, list[j])) {
+						list[j + 1] = list[j];
+						--j;
+					}
+					list[j + 1] = key;
+				}
+			}
+
+			std::vector<SweepAndPruneProxy<T>>	proxies;
+			std::vector<SweepEndpoint>			endpoints;
+			std::vector<int>					freeIDs;
+
+			std::vector<int>					active;
+
+			int proxyCount;
+			int sweepAxis;
+			int newEndpoints;	//added since the last update
+		};
+	}
+}
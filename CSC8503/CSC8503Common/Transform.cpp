@@ -1,20 +1,81 @@
 #include "Transform.h"
+#include <algorithm>
 
 using namespace NCL::CSC8503;
 
 Transform::Transform()
 {
-	parent		= nullptr;
-	localScale	= Vector3(1, 1, 1);
+	parent			= nullptr;
+	localScale		= Vector3(1, 1, 1);
+	dirty			= true;
+	parentChanged	= false;
+	orderIndex		= -1;
 }
 
 Transform::Transform(const Vector3& position, Transform* p) {
-	parent = p;
+	parent			= nullptr;
+	dirty			= true;
+	parentChanged	= false;
+	orderIndex		= -1;
+	SetParent(p);
 	SetWorldPosition(position);
 }
 
+/*
+Children are left where they are in the world's eyes - at the root of the
+hierarchy, with their local state now relative to nothing. Copies share
+their original's links, so only links that point back at this transform
+are undone.
+*/
 Transform::~Transform()
 {
+	if (parent) {
+		parent->children.erase(std::remove(parent->children.begin(), parent->children.end(), this), parent->children.end());
+	}
+	for (Transform* c : children) {
+		if (c->parent == this) {
+			c->parent = nullptr;
+			c->MarkDirty();
+		}
+	}
+}
+
+void Transform::SetParent(Transform* newParent) {
+	if (newParent == parent) {
+		return;
+	}
+	if (parent) {
+		parent->children.erase(std::remove(parent->children.begin(), parent->children.end(), this), parent->children.end());
+	}
+	parent = newParent;
+	if (parent) {
+		parent->children.emplace_back(this);
+	}
+	parentChanged = true;
+	MarkDirty();
+}
+
+int Transform::GetDepth() const {
+	int depth = 0;
+	for (const Transform* t = parent; t; t = t->parent) {
+		depth++;
+	}
+	return depth;
+}
+
+/*
+Anything below a dirty transform is dirty too, as its world matrix is built
+on top of the parent's. A transform already marked has marked its children
+too, and updating it marks them again, so there's no need to go any further.
+*/
+void Transform::MarkDirty() {
+	if (dirty) {
+		return;
+	}
+	dirty = true;
+	for (Transform* c : children) {
+		c->MarkDirty();
+	}
 }
 
 void Transform::UpdateMatrices() {
@@ -31,6 +92,29 @@ void Transform::UpdateMatrices() {
 		worldMatrix			= localMatrix;
 		worldOrientation	= localOrientation;
 	}
+	renderMatrix = worldMatrix;
+	dirty		 = false;
+
+	for (Transform* c : children) {
+		c->MarkDirty();
+	}
+}
+
+/*
+Builds the render matrix from a local position and orientation, in the same
+way as the world matrix is built, without touching the transform's real state.
+*/
+void Transform::SetRenderState(const Vector3& renderPosition, const Quaternion& renderOrientation) {
+	renderMatrix =
+		Matrix4::Translation(renderPosition) *
+		Matrix4(renderOrientation) *
+		Matrix4::Scale(localScale);
+
+	if (parent) {
+		renderMatrix = parent->GetWorldMatrix() * renderMatrix;
+	}
+	//The render matrix has to be put back to the world matrix once this stops being called
+	MarkDirty();
 }
 
 void Transform::SetWorldPosition(const Vector3& worldPos) {
@@ -46,10 +130,12 @@ void Transform::SetWorldPosition(const Vector3& worldPos) {
 
 		worldMatrix.SetPositionVector(worldPos);
 	}
+	MarkDirty();
 }
 
 void Transform::SetLocalPosition(const Vector3& localPos) {
 	localPosition = localPos;
+	MarkDirty();
 }
 
 void Transform::SetWorldScale(const Vector3& worldScale) {
@@ -59,8 +145,10 @@ void Transform::SetWorldScale(const Vector3& worldScale) {
 	else {
 		localScale = worldScale;
 	}
+	MarkDirty();
 }
 
 void Transform::SetLocalScale(const Vector3& newScale) {
 	localScale = newScale;
+	MarkDirty();
 }
\ No newline at end of file
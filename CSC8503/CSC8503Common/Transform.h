@@ -29,8 +29,31 @@ namespace NCL {
 				return parent;
 			}
 
-			void SetParent(Transform* newParent) {
-				parent = newParent;
+			void SetParent(Transform* newParent);
+
+			bool HasChildren() const {
+				return !children.empty();
+			}
+
+			//How many parents there are above this transform
+			int GetDepth() const;
+
+			//Where the world keeps this transform in its parents-first order, or -1
+			int GetOrderIndex() const {
+				return orderIndex;
+			}
+
+			void SetOrderIndex(int index) {
+				orderIndex = index;
+			}
+
+			//Whether the parent has changed since the world last checked its order
+			bool HasParentChanged() const {
+				return parentChanged;
+			}
+
+			void ClearParentChanged() {
+				parentChanged = false;
 			}
 
 			Matrix4 GetWorldMatrix() const {
@@ -41,6 +64,14 @@ namespace NCL {
 				return localMatrix;
 			}
 
+			//What should be drawn - the world matrix, unless the physics
+			//system has smoothed it out between two of its steps
+			Matrix4 GetRenderMatrix() const {
+				return renderMatrix;
+			}
+
+			void SetRenderState(const Vector3& renderPosition, const Quaternion& renderOrientation);
+
 			Vector3 GetWorldPosition() const {
 				return worldMatrix.GetPositionVector();
 			}
@@ -59,6 +90,7 @@ namespace NCL {
 
 			void SetLocalOrientation(const Quaternion& newOr) {
 				localOrientation = newOr;
+				MarkDirty();
 			}
 
 			Quaternion GetWorldOrientation() const {
@@ -69,11 +101,20 @@ namespace NCL {
 				return worldOrientation.Conjugate().ToMatrix3();
 			}
 
+			//Whether the matrices are out of date with the local state, or
+			//with the state of a parent
+			bool IsDirty() const {
+				return dirty;
+			}
+
 			void UpdateMatrices();
 
 		protected:
+			void MarkDirty();
+
 			Matrix4		localMatrix;
 			Matrix4		worldMatrix;
+			Matrix4		renderMatrix;
 
 			Vector3		localPosition;
 			Vector3		localScale;
@@ -83,6 +124,10 @@ namespace NCL {
 			Transform*	parent;
 
 			vector<Transform*> children;
+
+			bool		dirty;
+			bool		parentChanged;
+			int			orderIndex;
 		};
 	}
 }
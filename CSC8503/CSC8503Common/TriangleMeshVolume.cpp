@@ -0,0 +1,204 @@
+#include "TriangleMeshVolume.h"
+#include "../../Common/MeshGeometry.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace NCL;
+using namespace CSC8503;
+
+//Triangles a leaf can be left holding before it's worth splitting
+static const int maxLeafTriangles = 4;
+
+TriangleMeshVolume::TriangleMeshVolume(const MeshGeometry& mesh, const Vector3& scale) {
+	type = VolumeType::Mesh;
+
+	const std::vector<Vector3>& positions = mesh.GetPositionData();
+	vertices.reserve(positions.size());
+	for (const Vector3& p : positions) {
+		vertices.emplace_back(p * scale);
+	}
+
+	//Meshes without indices are drawn straight from their vertices
+	std::vector<int> order;
+	if (mesh.GetIndexCount() > 0) {
+		for (unsigned int i : mesh.GetIndexData()) {
+			order.emplace_back((int)i);
+		}
+	}
+	else {
+		for (int i = 0; i < (int)vertices.size(); ++i) {
+			order.emplace_back(i);
+		}
+	}
+
+	if (mesh.GetPrimitiveType() == GeometryPrimitive::Triangles) {
+		indices.assign(order.begin(), order.end() - order.size() % 3);
+	}
+	else if (mesh.GetPrimitiveType() == GeometryPrimitive::TriangleStrip) {
+		//Every other triangle of a strip is wound the other way round
+		for (int i = 2; i < (int)order.size(); ++i) {
+			bool odd = (i & 1) != 0;
+			indices.emplace_back(order[odd ? i - 1 : i - 2]);
+			indices.emplace_back(order[odd ? i - 2 : i - 1]);
+			indices.emplace_back(order[i]);
+		}
+	}
+
+	int triangleCount = GetTriangleCount();
+	if (triangleCount == 0) {
+		return;
+	}
+	std::vector<Vector3>			centres(triangleCount);
+	std::vector<BroadphaseBounds>	triangleBounds(triangleCount);
+	std::vector<int>				triangles(triangleCount);
+
+	for (int i = 0; i < triangleCount; ++i) {
+		Vector3 a, b, c;
+		GetTriangle(i, a, b, c);
+		triangleBounds[i] = BroadphaseBounds::Merge(BroadphaseBounds(a, Vector3()),
+			BroadphaseBounds::Merge(BroadphaseBounds(b, Vector3()), BroadphaseBounds(c, Vector3())));
+		centres[i]		= (a + b + c) / 3.0f;
+		triangles[i]	= i;
+	}
+	nodes.reserve(triangleCount * 2 / maxLeafTriangles + 1);
+	nodes.emplace_back();
+	BuildNode(0, 0, triangleCount, triangles, centres, triangleBounds);
+
+	//The leaves refer to runs of the sorted order, so the indices are put into that order too
+	std::vector<int> sortedIndices(indices.size());
+	for (int i = 0; i < triangleCount; ++i) {
+		sortedIndices[i * 3 + 0] = indices[triangles[i] * 3 + 0];
+		sortedIndices[i * 3 + 1] = indices[triangles[i] * 3 + 1];
+		sortedIndices[i * 3 + 2] = indices[triangles[i] * 3 + 2];
+	}
+	indices.swap(sortedIndices);
+}
+
+TriangleMeshVolume::~TriangleMeshVolume() {
+}
+
+void TriangleMeshVolume::BuildNode(int node, int first, int count, std::vector<int>& order, const std::vector<Vector3>& centres,
+	const std::vector<BroadphaseBounds>& triangleBounds) {
+	BroadphaseBounds bounds = triangleBounds[order[first]];
+	for (int i = first + 1; i < first + count; ++i) {
+		bounds = BroadphaseBounds::Merge(bounds, triangleBounds[order[i]]);
+	}
+	nodes[node].bounds = bounds;
+
+	if (count <= maxLeafTriangles) {
+		nodes[node].left			= -1;
+		nodes[node].firstTriangle	= first;
+		nodes[node].triangleCount	= count;
+		return;
+	}
+	Vector3 size = bounds.max - bounds.min;
+	int axis = 0;
+	if (size.y > size[axis]) {
+		axis = 1;
+	}
+	if (size.z > size[axis]) {
+		axis = 2;
+	}
+	int half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+		[&](int a, int b) {
+			return centres[a][axis] < centres[b][axis];
+		}
+	);
+
+	int left = (int)nodes.size();
+	nodes.emplace_back();
+	nodes.emplace_back();
+
+	nodes[node].left			= left;
+	nodes[node].firstTriangle	= -1;
+	nodes[node].triangleCount	= 0;
+
+	BuildNode(left,		first,			half,			order, centres, triangleBounds);
+	BuildNode(left + 1, first + half,	count - half,	order, centres, triangleBounds);
+}
+
+//Moller-Trumbore, hitting both sides of the triangle
+static bool RayTriangleTest(const Vector3& start, const Vector3& direction, const Vector3& a, const Vector3& b, const Vector3& c, float& distance) {
+	Vector3 edge1 = b - a;
+	Vector3 edge2 = c - a;
+	Vector3 p = Vector3::Cross(direction, edge2);
+	float det = Vector3::Dot(edge1, p);
+	if (fabs(det) < 1e-8f) {
+		return false;
+	}
+	float inverseDet = 1.0f / det;
+	Vector3 s = start - a;
+	float u = Vector3::Dot(s, p) * inverseDet;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	Vector3 q = Vector3::Cross(s, edge1);
+	float v = Vector3::Dot(direction, q) * inverseDet;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	distance = Vector3::Dot(edge2, q) * inverseDet;
+	return distance >= 0.0f;
+}
+
+bool TriangleMeshVolume::RayCast(const Vector3& start, const Vector3& direction, float maxDistance, float& distance, Vector3& normal) const {
+	if (nodes.empty()) {
+		return false;
+	}
+	//Dividing by a zero component gives an infinity, which the slab test copes with
+	Vector3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	float	closest = maxDistance;
+	int		hit		= -1;
+
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const Node& n = nodes[stack[--stackSize]];
+		float enter;
+		if (!n.bounds.RayTest(start, inverseDirection, closest, enter)) {
+			continue;
+		}
+		if (n.triangleCount > 0) {
+			for (int i = n.firstTriangle; i < n.firstTriangle + n.triangleCount; ++i) {
+				Vector3 a, b, c;
+				GetTriangle(i, a, b, c);
+				float t;
+				if (RayTriangleTest(start, direction, a, b, c, t) && t < closest) {
+					closest = t;
+					hit		= i;
+				}
+			}
+			continue;
+		}
+		//The nearer child goes on top, so a close hit can rule out the other one
+		float enterLeft		= FLT_MAX;
+		float enterRight	= FLT_MAX;
+		bool hitLeft	= nodes[n.left].bounds.RayTest(start, inverseDirection, closest, enterLeft);
+		bool hitRight	= nodes[n.left + 1].bounds.RayTest(start, inverseDirection, closest, enterRight);
+		if (hitLeft && hitRight) {
+			stack[stackSize++] = enterLeft < enterRight ? n.left + 1 : n.left;
+			stack[stackSize++] = enterLeft < enterRight ? n.left : n.left + 1;
+		}
+		else if (hitLeft) {
+			stack[stackSize++] = n.left;
+		}
+		else if (hitRight) {
+			stack[stackSize++] = n.left + 1;
+		}
+	}
+	if (hit < 0) {
+		return false;
+	}
+	Vector3 a, b, c;
+	GetTriangle(hit, a, b, c);
+	normal = Vector3::Cross(b - a, c - a).Normalised();
+	if (Vector3::Dot(normal, direction) > 0.0f) {
+		normal = -normal;
+	}
+	distance = closest;
+	return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "CollisionVolume.h"
+#include "DynamicAABBTree.h"
+#include "../../Common/Vector3.h"
+#include <vector>
+
+namespace NCL {
+	class MeshGeometry;
+
+	/*
+	The triangles of a mesh, for static level geometry to be collided against
+	as it's drawn, rather than approximated by boxes. Triangles are kept in
+	the mesh's own space, scaled up front, and the object's position and
+	orientation are applied to whatever is being tested against them.
+
+	A bounding volume hierarchy is built over the triangles when the volume
+	is made, so rays and spheres only ever look at the handful of triangles
+	near them, however big the mesh is. Nodes are split at the median of
+	their triangles' centres along their longest side, so the tree is
+	always balanced. Mesh volumes don't move, so it's never rebuilt.
+	*/
+	class TriangleMeshVolume : CollisionVolume
+	{
+	public:
+		//Taken from the pooled ones in CollisionVolume, which the private inheritance would hide
+		using CollisionVolume::operator new;
+		using CollisionVolume::operator delete;
+
+		TriangleMeshVolume(const MeshGeometry& mesh, const Vector3& scale = Vector3(1, 1, 1));
+		~TriangleMeshVolume();
+
+		int GetTriangleCount() const {
+			return (int)indices.size() / 3;
+		}
+
+		void GetTriangle(int triangle, Vector3& a, Vector3& b, Vector3& c) const {
+			a = vertices[indices[triangle * 3 + 0]];
+			b = vertices[indices[triangle * 3 + 1]];
+			c = vertices[indices[triangle * 3 + 2]];
+		}
+
+		//The box round every triangle, in the mesh's own space
+		const CSC8503::BroadphaseBounds& GetLocalBounds() const {
+			return nodes.empty() ? emptyBounds : nodes[0].bounds;
+		}
+
+		/*
+		The closest triangle a ray in the mesh's own space hits within
+		maxDistance, along with how far along the ray it is, and the side of
+		the triangle the ray came in from.
+		*/
+		bool RayCast(const Vector3& start, const Vector3& direction, float maxDistance, float& distance, Vector3& normal) const;
+
+		/*
+		Calls func(triangle) for every triangle in a leaf whose box overlaps
+		the given box, in the mesh's own space. If func returns false, the
+		query stops early.
+		*/
+		template<class F>
+		void Query(const CSC8503::BroadphaseBounds& bounds, F func) const {
+			if (nodes.empty()) {
+				return;
+			}
+			int stack[64];
+			int stackSize = 0;
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0) {
+				const Node& n = nodes[stack[--stackSize]];
+				if (!n.bounds.Overlaps(bounds)) {
+					continue;
+				}
+				if (n.triangleCount > 0) {
+					for (int i = 0; i < n.triangleCount; ++i) {
+						if (!func(n.firstTriangle + i)) {
+							return;
+						}
+					}
+				}
+				else {
+					stack[stackSize++] = n.left;
+					stack[stackSize++] = n.left + 1;
+				}
+			}
+		}
+
+	protected:
+		//Leaves have triangles, everything else has both its children next to each other from left
+		struct Node {
+			CSC8503::BroadphaseBounds bounds;
+			int left;
+			int firstTriangle;
+			int triangleCount;
+		};
+
+		void BuildNode(int node, int first, int count, std::vector<int>& order, const std::vector<Vector3>& centres,
+			const std::vector<CSC8503::BroadphaseBounds>& triangleBounds);
+
+		std::vector<Vector3>	vertices;
+		std::vector<int>		indices;	//3 per triangle, sorted into leaf order
+		std::vector<Node>		nodes;
+
+		CSC8503::BroadphaseBounds emptyBounds;
+	};
+}
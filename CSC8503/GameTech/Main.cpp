@@ -8,6 +8,7 @@
 #include "../CSC8503Common/GameClient.h"
 
 #include "../CSC8503Common/NavigationGrid.h"
+#include "../CSC8503Common/Profiler.h"
 
 #include "TutorialGame.h"
 #include "NetworkedGame.h"
@@ -186,6 +187,7 @@ hide or show the
 
 */
 int main() {
+	PROFILE_THREAD("Main");
 
 	GoosegameServer();
 	GoosegameClient(0);
@@ -203,8 +205,10 @@ int main() {
 	w->LockMouseToWindow(true);
 
 	TutorialGame* g = new TutorialGame();
+	bool showProfile = false;
 //&& !Window::GetKeyboard()->KeyDown(KeyboardKeys::ESCAPE)
 	while (w->UpdateWindow() ) {
+		Profiler::NextFrame();
 
 		//GoosegameServer();
 
@@ -220,6 +224,17 @@ int main() {
 		if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::NEXT)) {
 			w->ShowConsole(false);
 		}
+		if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F5)) {
+			showProfile = !showProfile;
+		}
+		if (Window::GetKeyboard()->KeyPressed(KeyboardKeys::F6)) {
+			if (Profiler::WriteChromeTrace("ProfileTrace.json")) {
+				std::cout << "Wrote profile to ProfileTrace.json" << std::endl;
+			}
+		}
+		if (showProfile) {
+			Profiler::PrintSummary(Vector2(10, 680));
+		}
 
 		//DisplayPathfinding();
 
@@ -6,6 +6,7 @@
 #include "../../Common/TextureLoader.h"
 
 #include "../CSC8503Common/PositionConstraint.h"
+#include "../CSC8503Common/Profiler.h"
 
 using namespace NCL;
 using namespace CSC8503;
@@ -28,6 +29,14 @@ TutorialGame::TutorialGame()	{
 	renderer	= new GameTechRenderer(*world);
 	physics		= new PhysicsSystem(*world);
 
+	goose_water_detection	= false;
+	apple_goose_detection	= false;
+	apple_island_detection	= false;
+
+	physics->SetLayerReports(GooseLayer, AppleLayer, true);
+	physics->SetLayerReports(GooseLayer, WaterLayer, true);
+	physics->SetLayerReports(AppleLayer, IslandLayer, true);
+
 	forceMagnitude	= 10.0f;
 	useGravity		= false;
 	inSelectionMode = false;
@@ -89,6 +98,7 @@ TutorialGame::~TutorialGame()	{
 }
 
 void TutorialGame::UpdateGame(float dt) {
+	PROFILE_ZONE("TutorialGame::UpdateGame");
 	TimerDT = dt;
 	if (developmod) {
 		if (!inSelectionMode) {
@@ -111,7 +121,8 @@ void TutorialGame::UpdateGame(float dt) {
 		world->UpdateWorld(dt);
 		renderer->Update(dt);
 		physics->Update(dt);
-		constraint->UpdateConstraint(dt);
+		physics->DispatchCollisionEvents();
+		ReadContactEvents();
 		Debug::FlushRenderables();
 		renderer->Render();
 
@@ -138,7 +149,8 @@ void TutorialGame::UpdateGame(float dt) {
 		world->UpdateWorld(dt);
 		renderer->Update(dt);
 		physics->Update(dt);
-		constraint->UpdateConstraint(dt);
+		physics->DispatchCollisionEvents();
+		ReadContactEvents();
 		Debug::FlushRenderables();
 		renderer->Render();
 
@@ -393,13 +405,12 @@ void TutorialGame::InitWorld() {
 	AddFloorToWorld(Vector3(-55, -9, 0));
 	AddFloorToWorld(Vector3(55, -9, 0));
 	AddWaterToWorld(Vector3(0, -9, 0));
-	AddIslandToWorld(myIslandPos, "myisland");
+	AddIslandToWorld(myIslandPos, "myisland")->SetCollisionLayer(IslandLayer);
 	AddMapToWorld();
 	AddGameManual();
 
 
 	previous = CanadaGoose;
-	constraint = new PositionConstraint(previous, nullptr, 3);
 
 	if (DoubleMod)
 	{
@@ -491,6 +502,7 @@ GameObject* TutorialGame::AddWaterToWorld(const Vector3& position) {
 
 	water->GetPhysicsObject()->SetInverseMass(0);
 	water->GetPhysicsObject()->InitCubeInertia();
+	water->SetCollisionLayer(WaterLayer);
 	//water->isWall = 1;
 	world->AddGameObject(water);
 	water->GetRenderObject()->SetColour(Vector4(0, 0.8, 1, 1));
@@ -565,6 +577,8 @@ GameObject* TutorialGame::AddGooseToWorld(const Vector3& position)
 
 	goose->GetPhysicsObject()->SetInverseMass(inverseMass);
 	goose->GetPhysicsObject()->InitSphereInertia();
+	goose->GetPhysicsObject()->SetContinuousCollision(true);
+	goose->SetCollisionLayer(GooseLayer);
 
 	world->AddGameObject(goose);
 
@@ -622,6 +636,7 @@ GameObject* TutorialGame::AddParkKeeperToWorld(const Vector3& position)
 
 	keeper->GetPhysicsObject()->SetInverseMass(inverseMass);
 	keeper->GetPhysicsObject()->InitCubeInertia();
+	keeper->SetCollisionLayer(KeeperLayer);
 
 	world->AddGameObject(keeper);
 
@@ -743,10 +758,10 @@ void TutorialGame::ParkKpeeperMove(void*) {
 		
 	}
 
-	if (This_TutorialGame->physics->apple_island_detection == true)
+	if (This_TutorialGame->apple_island_detection == true)
 	{
 		This_TutorialGame->score += 10;
-		This_TutorialGame->physics->apple_island_detection = false;
+		This_TutorialGame->apple_island_detection = false;
 		This_TutorialGame->PKflag = 1;
 	}
 
@@ -756,12 +771,40 @@ void TutorialGame::ParkKpeeperDetection(void* ) {
 	Vector3 PGRANGE = This_TutorialGame->ParkKeeper->GetTransform().GetWorldPosition() - This_TutorialGame->CanadaGoose->GetTransform().GetWorldPosition();
 	This_TutorialGame->parkkeeper_goose_range = PGRANGE.x * PGRANGE.x + PGRANGE.z * PGRANGE.z;
 	
-		if (This_TutorialGame->parkkeeper_goose_range < 1000) {
+		if (This_TutorialGame->parkkeeper_goose_range < 1000 && This_TutorialGame->KeeperCanSeeGoose()) {
 			This_TutorialGame->PKflag = 0;
 		}
 	
 }
 
+/*
+The keeper only gives chase if nothing is in the way. A ray goes from the
+keeper's eyes to the bottom, middle and top of the goose, all in one batch,
+and the goose has been seen if any of them get to it before hitting anything
+else. The keeper's own box and the water the goose swims in don't block it.
+*/
+bool TutorialGame::KeeperCanSeeGoose() const {
+	Vector3 eyes	= ParkKeeper->GetTransform().GetWorldPosition() + Vector3(0, 3, 0);
+	Vector3 goose	= CanadaGoose->GetTransform().GetWorldPosition();
+
+	unsigned int layers = ~((1u << KeeperLayer) | (1u << WaterLayer));
+
+	std::vector<RayQuery> rays;
+	for (float height : { -0.8f, 0.0f, 0.8f }) {
+		Vector3 toGoose = goose + Vector3(0, height, 0) - eyes;
+		rays.emplace_back(Ray(eyes, toGoose.Normalised()), layers, toGoose.Length() + 1.0f);
+	}
+	std::vector<RayCollision> hits;
+	world->RaycastBatch(rays, hits);
+
+	for (const RayCollision& hit : hits) {
+		if (hit.node == CanadaGoose) {
+			return true;
+		}
+	}
+	return false;
+}
+
 GameObject* TutorialGame::AddCharacterToWorld(const Vector3& position) {
 	float meshSize = 4.0f;
 	float inverseMass = 0.5f;
@@ -857,27 +900,52 @@ GameObject* TutorialGame::AddAppleToWorld(const Vector3& position) {
 
 	apple->GetPhysicsObject()->SetInverseMass(1.0f);
 	apple->GetPhysicsObject()->InitSphereInertia();
+	apple->GetPhysicsObject()->SetContinuousCollision(true);
 	apple->GetRenderObject()->SetColour(Vector4(1, 0, 0, 1));
+	apple->SetCollisionLayer(AppleLayer);
 
 	world->AddGameObject(apple);
 
 	return apple;
 }
 
+//Only the layers set to report contacts in the constructor raise contact events, whichever way round
+void TutorialGame::ReadContactEvents() {
+	for (const CollisionEvent& e : physics->GetCollisionEvents()) {
+		if (e.type != CollisionEventType::Contact || !e.a || !e.b) {
+			continue;
+		}
+		GameObject* a = e.a;
+		GameObject* b = e.b;
+		for (int k = 0; k < 2; ++k) {
+			if (a->GetCollisionLayer() == GooseLayer && b->GetCollisionLayer() == AppleLayer) {
+				apple_goose_detection = true;
+			}
+			if (a->GetCollisionLayer() == GooseLayer && b->GetCollisionLayer() == WaterLayer) {
+				goose_water_detection = true;
+			}
+			if (a->GetCollisionLayer() == AppleLayer && b->GetCollisionLayer() == IslandLayer) {
+				apple_island_detection = true;
+			}
+			std::swap(a, b);
+		}
+	}
+}
+
 void TutorialGame::AppleDetection() {
 
 
 
-	if (physics->apple_goose_detection == true) {
+	if (apple_goose_detection == true) {
 		AddGooseConstraint(RedApple);
-		physics->apple_goose_detection = false;
+		apple_goose_detection = false;
 
 	}
 
 }
 
 void TutorialGame::WaterDetection() {
-	if (physics->goose_water_detection == true) {
+	if (goose_water_detection == true) {
 		if (Window::GetKeyboard()->KeyDown(KeyboardKeys::I)) {
 			CanadaGoose->GetPhysicsObject()->AddForce(GooseRay->GetDirection() * 1000.0f);
 		}
@@ -1099,6 +1167,8 @@ void TutorialGame::ExitSelect(void*) {
 
 	This_TutorialGame->ButtonReplay->GetTransform().SetWorldPosition(Vector3(-300, 10, -315));
 	This_TutorialGame->ButtonExit->GetTransform().SetWorldPosition(Vector3(-300, 10, -285));
+	This_TutorialGame->world->UpdateStaticObject(This_TutorialGame->ButtonReplay);
+	This_TutorialGame->world->UpdateStaticObject(This_TutorialGame->ButtonExit);
 
 	Debug::Print("score is " + This_TutorialGame->score, Vector2(10, 80));
 
@@ -1115,6 +1185,8 @@ void TutorialGame::ExitSelect(void*) {
 				
 				This_TutorialGame->ButtonReplay->GetTransform().SetWorldPosition(Vector3(-300, -10, -315));
 				This_TutorialGame->ButtonExit->GetTransform().SetWorldPosition(Vector3(-300, -10, -285));
+				This_TutorialGame->world->UpdateStaticObject(This_TutorialGame->ButtonReplay);
+				This_TutorialGame->world->UpdateStaticObject(This_TutorialGame->ButtonExit);
 				This_TutorialGame->Manualflag = 3;
 			}
 
@@ -30,6 +30,16 @@ namespace NCL {
 			}
 
 		protected:
+			//The kinds of object whose contacts the game needs to hear about
+			enum CollisionLayers {
+				DefaultLayer,
+				GooseLayer,
+				AppleLayer,
+				WaterLayer,
+				IslandLayer,
+				KeeperLayer
+			};
+
 			void InitialiseAssets();
 
 			void InitCamera();
@@ -100,8 +110,14 @@ namespace NCL {
 			Ray* GooseRay;
 			float parkkeeper_goose_range;
 
+			void ReadContactEvents();
+			bool goose_water_detection;
+			bool apple_goose_detection;
+			bool apple_island_detection;
+
 			void WaterDetection();
 			void AppleDetection();
+			bool KeeperCanSeeGoose() const;
 			void CanadaGooseMove();
 			void enemyMove();
 			static void ParkKpeeperMove(void*);
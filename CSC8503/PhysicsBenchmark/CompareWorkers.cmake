@@ -0,0 +1,31 @@
+#Runs the benchmark once per worker count and fails unless every run ends with
+#the same checksum, as the physics has to come out the same however the jobs
+#are split up.
+#Expects BENCHMARK (the executable), WORKERS (a list of counts), ARGS (the rest
+#of the benchmark's arguments) and OUTPUT_DIR to be passed in with -D.
+separate_arguments(ARGS)
+
+set(firstChecksum "")
+foreach(workers ${WORKERS})
+	set(jsonFile "${OUTPUT_DIR}/workers${workers}.json")
+	execute_process(
+		COMMAND "${BENCHMARK}" ${ARGS} --workers ${workers} --json "${jsonFile}"
+		RESULT_VARIABLE result
+	)
+	if(NOT result EQUAL 0)
+		message(FATAL_ERROR "PhysicsBenchmark with ${workers} workers failed: ${result}")
+	endif()
+
+	file(READ "${jsonFile}" json)
+	string(REGEX MATCHALL "\"checksum\": \"[0-9a-f]+\"" checksums "${json}")
+	if(NOT checksums)
+		message(FATAL_ERROR "No checksum in ${jsonFile}")
+	endif()
+
+	message(STATUS "${workers} workers: ${checksums}")
+	if(firstChecksum STREQUAL "")
+		set(firstChecksum "${checksums}")
+	elseif(NOT checksums STREQUAL firstChecksum)
+		message(FATAL_ERROR "${workers} workers gave ${checksums}, expected ${firstChecksum}")
+	endif()
+endforeach()
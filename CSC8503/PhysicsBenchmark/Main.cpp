@@ -0,0 +1,627 @@
+/*
+A headless benchmark for the physics system. It builds the same grid scenes
+as TutorialGame's Init*GridWorld functions, without a window or renderer, and
+steps them for a fixed number of frames of a fixed length, so two runs with
+the same settings do exactly the same work. Each run's timings, pair counts
+and allocations are written out as JSON, for comparing one build against the
+next, along with a checksum of where everything ended up.
+
+With --raycasts N, N rays are also cast across each scene once it has been
+stepped, both one at a time and in batches, and the program fails if the
+batches don't find the same hits.
+
+Usage:
+	PhysicsBenchmark [--scene spheres|mixed|cubes|all] [--bodies 100,1000,...]
+		[--frames N] [--warmup N] [--layers N] [--workers N] [--seed N]
+		[--sap] [--basic] [--no-sleep] [--raycasts N] [--json file]
+*/
+#include "../CSC8503Common/GameWorld.h"
+#include "../CSC8503Common/PhysicsSystem.h"
+#include "../CSC8503Common/GameObject.h"
+#include "../CSC8503Common/AABBVolume.h"
+#include "../CSC8503Common/SphereVolume.h"
+#include "../../Common/GameTimer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace NCL;
+using namespace CSC8503;
+
+/*
+Every allocation made by the program goes through here, so the benchmark can
+tell how many the physics update makes each frame. Only the count and size
+are kept, nothing is tracked per pointer.
+*/
+static std::atomic<uint64_t> allocationCount(0);
+static std::atomic<uint64_t> allocationBytes(0);
+
+void* operator new(size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocationBytes.fetch_add(size, std::memory_order_relaxed);
+	void* memory = malloc(size ? size : 1);
+	if (!memory) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+	free(memory);
+}
+
+enum class BenchmarkScene {
+	Spheres,
+	Mixed,
+	Cubes
+};
+
+static const char* sceneNames[] = { "spheres", "mixed", "cubes" };
+
+struct BenchmarkSettings {
+	std::vector<BenchmarkScene> scenes;
+	std::vector<int>			bodyCounts;
+	int			frames			= 300;
+	int			warmupFrames	= 0;
+	int			layers			= 1;
+	int			workers			= 1;
+	int			raycasts		= 0;
+	unsigned	seed			= 1234;
+	bool		sweepAndPrune	= false;
+	bool		broadphase		= true;
+	bool		sleeping		= true;
+	std::string jsonFile;
+};
+
+struct BenchmarkResult {
+	BenchmarkScene	scene;
+	int				bodies		= 0;
+	float			setupTime	= 0.0f;
+
+	//Sums over the measured frames, divided down when written out
+	double	frameTime			= 0.0;
+	double	maxFrameTime		= 0.0;
+	double	integrateTime		= 0.0;
+	double	broadphaseTime		= 0.0;
+	double	narrowphaseTime		= 0.0;
+	double	solveTime			= 0.0;
+	double	continuousTime		= 0.0;
+	double	sleepingTime		= 0.0;
+	double	collisionListTime	= 0.0;
+	double	broadphasePairs		= 0.0;
+	double	contacts			= 0.0;
+	double	trackedPairs		= 0.0;
+	double	awakeBodies			= 0.0;
+	int		maxBroadphasePairs	= 0;
+	int		steps				= 0;
+	uint64_t allocations		= 0;
+	uint64_t allocatedBytes		= 0;
+
+	uint64_t checksum			= 0;
+
+	//Totals for casting every ray once, each way
+	double	singleRayTime		= 0.0;
+	double	batchRayTime		= 0.0;
+	double	jobBatchRayTime		= 0.0;
+	int		raycastMismatches	= 0;
+};
+
+/*
+The objects are the same shapes, sizes and masses as TutorialGame gives them,
+but with no render object. Unlike the game's fixed size floor, the floor here
+is stretched to fit under however big the grid has been made.
+*/
+static GameObject* AddFloor(GameWorld& world, const Vector3& position, const Vector3& floorSize) {
+	GameObject* floor = new GameObject("floor");
+
+	AABBVolume* volume = new AABBVolume(floorSize);
+	floor->SetBoundingVolume((CollisionVolume*)volume);
+	floor->GetTransform().SetWorldScale(floorSize);
+	floor->GetTransform().SetWorldPosition(position);
+
+	floor->SetPhysicsObject(new PhysicsObject(&floor->GetTransform(), floor->GetBoundingVolume()));
+
+	floor->GetPhysicsObject()->SetInverseMass(0);
+	floor->GetPhysicsObject()->InitCubeInertia();
+
+	world.AddGameObject(floor);
+	return floor;
+}
+
+static GameObject* AddSphere(GameWorld& world, const Vector3& position, float radius, float inverseMass) {
+	GameObject* sphere = new GameObject("sphere");
+
+	SphereVolume* volume = new SphereVolume(radius);
+	sphere->SetBoundingVolume((CollisionVolume*)volume);
+	sphere->GetTransform().SetWorldScale(Vector3(radius, radius, radius));
+	sphere->GetTransform().SetWorldPosition(position);
+
+	sphere->SetPhysicsObject(new PhysicsObject(&sphere->GetTransform(), sphere->GetBoundingVolume()));
+
+	sphere->GetPhysicsObject()->SetInverseMass(inverseMass);
+	sphere->GetPhysicsObject()->InitSphereInertia();
+
+	world.AddGameObject(sphere);
+	return sphere;
+}
+
+static GameObject* AddCube(GameWorld& world, const Vector3& position, const Vector3& dimensions, float inverseMass) {
+	GameObject* cube = new GameObject("cube");
+
+	AABBVolume* volume = new AABBVolume(dimensions);
+	cube->SetBoundingVolume((CollisionVolume*)volume);
+	cube->GetTransform().SetWorldPosition(position);
+	cube->GetTransform().SetWorldScale(dimensions);
+
+	cube->SetPhysicsObject(new PhysicsObject(&cube->GetTransform(), cube->GetBoundingVolume()));
+
+	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
+	cube->GetPhysicsObject()->InitCubeInertia();
+
+	world.AddGameObject(cube);
+	return cube;
+}
+
+/*
+Lays out bodyCount objects on a roughly square grid, 10 units up, as the
+Init*GridWorld functions do. Extra layers are stacked on top of the first,
+and the mixed scene's choice of cube or sphere comes from a generator whose
+sequence is fixed by the standard, so it's the same on every platform.
+*/
+static void BuildScene(GameWorld& world, BenchmarkScene scene, int bodyCount, int layers, unsigned seed) {
+	const float spacing		= 3.0f;
+	const float radius		= 1.0f;
+	const Vector3 cubeDims	= Vector3(1, 1, 1);
+
+	int perLayer	= (bodyCount + layers - 1) / layers;
+	int numCols		= (int)std::ceil(std::sqrt((float)perLayer));
+	int numRows		= (perLayer + numCols - 1) / numCols;
+
+	std::minstd_rand random(seed);
+
+	int added = 0;
+	for (int y = 0; y < layers && added < bodyCount; ++y) {
+		for (int x = 0; x < numCols && added < bodyCount; ++x) {
+			for (int z = 0; z < numRows && added < bodyCount; ++z) {
+				Vector3 position = Vector3(x * spacing, 10.0f + y * spacing, z * spacing);
+
+				switch (scene) {
+					case BenchmarkScene::Spheres: {
+						AddSphere(world, position, radius, 1.0f);
+					}break;
+					case BenchmarkScene::Mixed: {
+						if (random() % 2) {
+							AddCube(world, position, cubeDims, 10.0f);
+						}
+						else {
+							AddSphere(world, position, radius, 10.0f);
+						}
+					}break;
+					case BenchmarkScene::Cubes: {
+						AddCube(world, position, cubeDims, 1.0f);
+					}break;
+				}
+				added++;
+			}
+		}
+	}
+	Vector3 halfSize = Vector3(numCols * spacing * 0.5f + 5.0f, 1.0f, numRows * spacing * 0.5f + 5.0f);
+	Vector3 centre	 = Vector3((numCols - 1) * spacing * 0.5f, -2.0f, (numRows - 1) * spacing * 0.5f);
+	AddFloor(world, centre, halfSize);
+}
+
+//FNV-1a over the exact bits of every object's position, in the order they were added
+static uint64_t PositionChecksum(GameWorld& world) {
+	uint64_t hash = 14695981039346656037ull;
+
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	world.GetObjectIterators(first, last);
+
+	for (auto i = first; i != last; ++i) {
+		Vector3 position = (*i)->GetTransform().GetWorldPosition();
+		float values[3] = { position.x, position.y, position.z };
+
+		unsigned char bytes[sizeof(values)];
+		memcpy(bytes, values, sizeof(values));
+		for (unsigned char b : bytes) {
+			hash ^= b;
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+/*
+Whether a batched ray found what the same ray cast on its own did. Rays
+happy with any hit can be given a different object depending on the order
+the trees are walked in, which in a batch depends on the other rays in the
+packet, so for those it's only checked that the batch hits something
+exactly when the single cast does, and that what it hit is one the ray was
+allowed to hit.
+*/
+static bool SameRayHit(const RayQuery& query, const RayCollision& single, const RayCollision& batch) {
+	if ((single.node != nullptr) != (batch.node != nullptr)) {
+		return false;
+	}
+	if (!single.node) {
+		return true;
+	}
+	if (query.closestObject) {
+		return single.node == batch.node && single.rayDistance == batch.rayDistance;
+	}
+	GameObject* o = (GameObject*)batch.node;
+	RayCollision check;
+	return (o->GetCollisionLayerMask() & query.layerMask) && batch.rayDistance <= query.maxDistance &&
+		CollisionDetection::RayIntersection(query.ray, *o, check) && check.rayDistance == batch.rayDistance;
+}
+
+/*
+Casts fans of rays, as line of sight checks would, from points above and
+around the scene at random points within it. They're cast one Raycast at a
+time, then as a RaycastBatch, then as a batch split up between the physics
+system's workers. The objects are spread over four collision layers, and
+the rays take turns at which layers they can hit, whether they stop short,
+and whether they want the closest hit or any.
+*/
+static void RunRaycasts(const BenchmarkSettings& settings, GameWorld& world, PhysicsSystem& physics, BenchmarkResult& result) {
+	std::vector<GameObject*>::const_iterator first;
+	std::vector<GameObject*>::const_iterator last;
+	world.GetObjectIterators(first, last);
+
+	Vector3 boundsMin = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	Vector3 boundsMax = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	int layer = 0;
+	for (auto i = first; i != last; ++i) {
+		(*i)->SetCollisionLayer(layer++ % 4);
+
+		Vector3 position = (*i)->GetTransform().GetWorldPosition();
+		boundsMin = Vector3(std::min(boundsMin.x, position.x), std::min(boundsMin.y, position.y), std::min(boundsMin.z, position.z));
+		boundsMax = Vector3(std::max(boundsMax.x, position.x), std::max(boundsMax.y, position.y), std::max(boundsMax.z, position.z));
+	}
+
+	std::minstd_rand random(settings.seed);
+	auto between = [&](float low, float high) {
+		return low + (high - low) * (random() - random.min()) / (float)(random.max() - random.min());
+	};
+	const unsigned int layerMasks[] = { ~0u, 0x5, 0x2 };
+
+	std::vector<RayQuery> queries;
+	Vector3 origin;
+	for (int i = 0; i < settings.raycasts; ++i) {
+		if (i % BroadphaseRayPacket::maxRays == 0) {
+			int		fan		= i / BroadphaseRayPacket::maxRays;
+			float	height	= fan % 4 == 0 ? between(boundsMin.y, boundsMax.y) : boundsMax.y + between(2.0f, 20.0f);
+			origin = Vector3(between(boundsMin.x - 10.0f, boundsMax.x + 10.0f), height, between(boundsMin.z - 10.0f, boundsMax.z + 10.0f));
+		}
+		Vector3 target	= Vector3(between(boundsMin.x, boundsMax.x), between(boundsMin.y, boundsMax.y), between(boundsMin.z, boundsMax.z));
+
+		Vector3 toTarget	= target - origin;
+		float	distance	= (i / 6) % 2 ? toTarget.Length() * 0.5f : FLT_MAX;
+		queries.emplace_back(Ray(origin, toTarget.Normalised()), layerMasks[(i / 2) % 3], distance, i % 2 == 0);
+	}
+
+	std::vector<RayCollision> single(queries.size());
+	std::vector<RayCollision> batch;
+	std::vector<RayCollision> jobBatch;
+
+	GameTimer timer;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		Ray ray = queries[i].ray;
+		world.Raycast(ray, single[i], queries[i].closestObject, queries[i].maxDistance, queries[i].layerMask);
+	}
+	timer.Tick();
+	result.singleRayTime = timer.GetTimeDeltaSeconds();
+
+	world.RaycastBatch(queries, batch);
+	timer.Tick();
+	result.batchRayTime = timer.GetTimeDeltaSeconds();
+
+	world.RaycastBatch(queries, jobBatch, &physics.GetJobSystem());
+	timer.Tick();
+	result.jobBatchRayTime = timer.GetTimeDeltaSeconds();
+
+	for (size_t i = 0; i < queries.size(); ++i) {
+		if (!SameRayHit(queries[i], single[i], batch[i]) || !SameRayHit(queries[i], single[i], jobBatch[i])) {
+			result.raycastMismatches++;
+		}
+	}
+}
+
+static BenchmarkResult RunBenchmark(const BenchmarkSettings& settings, BenchmarkScene scene, int bodyCount) {
+	const float frameTime = 1.0f / 60.0f;
+
+	BenchmarkResult result;
+	result.scene	= scene;
+	result.bodies	= bodyCount;
+
+	GameWorld		world;
+	PhysicsSystem	physics(world);
+
+	physics.UseGravity(true);
+	physics.SetWorkerCount(settings.workers);
+	physics.UseSweepAndPrune(settings.sweepAndPrune);
+	physics.UseSleeping(settings.sleeping);
+	physics.UseBroadPhase(settings.broadphase);
+
+	GameTimer timer;
+	BuildScene(world, scene, bodyCount, settings.layers, settings.seed);
+	timer.Tick();
+	result.setupTime = timer.GetTimeDeltaSeconds();
+
+	for (int i = 0; i < settings.warmupFrames; ++i) {
+		world.UpdateWorld(frameTime);
+		physics.Update(frameTime);
+	}
+
+	for (int i = 0; i < settings.frames; ++i) {
+		uint64_t allocationsBefore	= allocationCount.load(std::memory_order_relaxed);
+		uint64_t bytesBefore		= allocationBytes.load(std::memory_order_relaxed);
+
+		world.UpdateWorld(frameTime);
+		physics.Update(frameTime);
+
+		result.allocations		+= allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+		result.allocatedBytes	+= allocationBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+		const PhysicsStepStats& stats = physics.GetStepStats();
+
+		result.frameTime		+= stats.totalTime;
+		result.maxFrameTime		= std::max(result.maxFrameTime, (double)stats.totalTime);
+		result.integrateTime	+= stats.integrateTime;
+		result.broadphaseTime	+= stats.broadphaseTime;
+		result.narrowphaseTime	+= stats.narrowphaseTime;
+		result.solveTime		+= stats.solveTime;
+		result.continuousTime	+= stats.continuousTime;
+		result.sleepingTime		+= stats.sleepingTime;
+		result.collisionListTime += stats.collisionListTime;
+		result.broadphasePairs	+= stats.broadphasePairs;
+		result.contacts			+= stats.contacts;
+		result.trackedPairs		+= stats.trackedPairs;
+		result.awakeBodies		+= stats.awakeBodies;
+		result.steps			+= stats.steps;
+
+		result.maxBroadphasePairs = std::max(result.maxBroadphasePairs, stats.broadphasePairs);
+	}
+	result.checksum = PositionChecksum(world);
+
+	if (settings.raycasts > 0) {
+		RunRaycasts(settings, world, physics, result);
+	}
+
+	world.ClearAndErase();
+	physics.Clear();
+	return result;
+}
+
+static std::string ToJson(const BenchmarkSettings& settings, const std::vector<BenchmarkResult>& results) {
+	std::ostringstream out;
+	out.precision(6);
+	out << std::fixed;
+
+	auto ms = [&](double seconds) {
+		return seconds * 1000.0 / std::max(settings.frames, 1);
+	};
+	auto perFrame = [&](double value) {
+		return value / std::max(settings.frames, 1);
+	};
+	auto perRay = [&](double seconds) {
+		return seconds * 1000000.0 / std::max(settings.raycasts, 1);
+	};
+
+	out << "{\n";
+	out << "\t\"frames\": " << settings.frames << ",\n";
+	out << "\t\"warmupFrames\": " << settings.warmupFrames << ",\n";
+	out << "\t\"layers\": " << settings.layers << ",\n";
+	out << "\t\"workers\": " << settings.workers << ",\n";
+	out << "\t\"seed\": " << settings.seed << ",\n";
+	out << "\t\"broadphase\": \"" << (!settings.broadphase ? "none" : settings.sweepAndPrune ? "sap" : "tree") << "\",\n";
+	out << "\t\"sleeping\": " << (settings.sleeping ? "true" : "false") << ",\n";
+	out << "\t\"runs\": [\n";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchmarkResult& r = results[i];
+
+		out << "\t\t{\n";
+		out << "\t\t\t\"scene\": \"" << sceneNames[(int)r.scene] << "\",\n";
+		out << "\t\t\t\"bodies\": " << r.bodies << ",\n";
+		out << "\t\t\t\"setupMs\": " << r.setupTime * 1000.0 << ",\n";
+		out << "\t\t\t\"stepsPerFrame\": " << perFrame(r.steps) << ",\n";
+		out << "\t\t\t\"frameMs\": " << ms(r.frameTime) << ",\n";
+		out << "\t\t\t\"maxFrameMs\": " << r.maxFrameTime * 1000.0 << ",\n";
+		out << "\t\t\t\"phasesMs\": {\n";
+		out << "\t\t\t\t\"integrate\": " << ms(r.integrateTime) << ",\n";
+		out << "\t\t\t\t\"broadphase\": " << ms(r.broadphaseTime) << ",\n";
+		out << "\t\t\t\t\"narrowphase\": " << ms(r.narrowphaseTime) << ",\n";
+		out << "\t\t\t\t\"solve\": " << ms(r.solveTime) << ",\n";
+		out << "\t\t\t\t\"continuous\": " << ms(r.continuousTime) << ",\n";
+		out << "\t\t\t\t\"sleeping\": " << ms(r.sleepingTime) << ",\n";
+		out << "\t\t\t\t\"collisionList\": " << ms(r.collisionListTime) << "\n";
+		out << "\t\t\t},\n";
+		out << "\t\t\t\"broadphasePairs\": " << perFrame(r.broadphasePairs) << ",\n";
+		out << "\t\t\t\"maxBroadphasePairs\": " << r.maxBroadphasePairs << ",\n";
+		out << "\t\t\t\"contacts\": " << perFrame(r.contacts) << ",\n";
+		out << "\t\t\t\"trackedPairs\": " << perFrame(r.trackedPairs) << ",\n";
+		out << "\t\t\t\"awakeBodies\": " << perFrame(r.awakeBodies) << ",\n";
+		out << "\t\t\t\"allocationsPerFrame\": " << perFrame((double)r.allocations) << ",\n";
+		out << "\t\t\t\"allocatedBytesPerFrame\": " << perFrame((double)r.allocatedBytes) << ",\n";
+		if (settings.raycasts > 0) {
+			out << "\t\t\t\"raycasts\": " << settings.raycasts << ",\n";
+			out << "\t\t\t\"rayUs\": {\n";
+			out << "\t\t\t\t\"single\": " << perRay(r.singleRayTime) << ",\n";
+			out << "\t\t\t\t\"batch\": " << perRay(r.batchRayTime) << ",\n";
+			out << "\t\t\t\t\"batchJobs\": " << perRay(r.jobBatchRayTime) << "\n";
+			out << "\t\t\t},\n";
+			out << "\t\t\t\"raycastMismatches\": " << r.raycastMismatches << ",\n";
+		}
+		out << "\t\t\t\"checksum\": \"" << std::hex << r.checksum << std::dec << "\"\n";
+		out << "\t\t}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "\t]\n";
+	out << "}\n";
+	return out.str();
+}
+
+static bool ParseBodyCounts(const std::string& text, std::vector<int>& counts) {
+	std::istringstream in(text);
+	std::string entry;
+	while (std::getline(in, entry, ',')) {
+		int count = atoi(entry.c_str());
+		if (count <= 0) {
+			return false;
+		}
+		counts.emplace_back(count);
+	}
+	return !counts.empty();
+}
+
+static bool ParseArguments(int argc, char** argv, BenchmarkSettings& settings) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue	= i + 1 < argc;
+
+		if (arg == "--scene" && hasValue) {
+			std::string name = argv[++i];
+			if (name == "all") {
+				settings.scenes = { BenchmarkScene::Spheres, BenchmarkScene::Mixed, BenchmarkScene::Cubes };
+			}
+			else if (name == "spheres") {
+				settings.scenes = { BenchmarkScene::Spheres };
+			}
+			else if (name == "mixed") {
+				settings.scenes = { BenchmarkScene::Mixed };
+			}
+			else if (name == "cubes") {
+				settings.scenes = { BenchmarkScene::Cubes };
+			}
+			else {
+				return false;
+			}
+		}
+		else if (arg == "--bodies" && hasValue) {
+			settings.bodyCounts.clear();
+			if (!ParseBodyCounts(argv[++i], settings.bodyCounts)) {
+				return false;
+			}
+		}
+		else if (arg == "--frames" && hasValue) {
+			settings.frames = atoi(argv[++i]);
+		}
+		else if (arg == "--warmup" && hasValue) {
+			settings.warmupFrames = atoi(argv[++i]);
+		}
+		else if (arg == "--layers" && hasValue) {
+			settings.layers = atoi(argv[++i]);
+		}
+		else if (arg == "--workers" && hasValue) {
+			settings.workers = atoi(argv[++i]);
+		}
+		else if (arg == "--raycasts" && hasValue) {
+			settings.raycasts = atoi(argv[++i]);
+		}
+		else if (arg == "--seed" && hasValue) {
+			settings.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--json" && hasValue) {
+			settings.jsonFile = argv[++i];
+		}
+		else if (arg == "--sap") {
+			settings.sweepAndPrune = true;
+		}
+		else if (arg == "--basic") {
+			settings.broadphase = false;
+		}
+		else if (arg == "--no-sleep") {
+			settings.sleeping = false;
+		}
+		else {
+			return false;
+		}
+	}
+	if (settings.scenes.empty()) {
+		settings.scenes = { BenchmarkScene::Spheres, BenchmarkScene::Mixed, BenchmarkScene::Cubes };
+	}
+	if (settings.bodyCounts.empty()) {
+		settings.bodyCounts = { 100, 1000, 10000 };
+	}
+	return settings.frames > 0 && settings.warmupFrames >= 0 && settings.layers > 0 && settings.workers > 0 && settings.raycasts >= 0;
+}
+
+int main(int argc, char** argv) {
+	BenchmarkSettings settings;
+	if (!ParseArguments(argc, argv, settings)) {
+		std::cerr << "Usage: PhysicsBenchmark [--scene spheres|mixed|cubes|all] [--bodies 100,1000,...]\n"
+			<< "\t[--frames N] [--warmup N] [--layers N] [--workers N] [--seed N]\n"
+			<< "\t[--sap] [--basic] [--no-sleep] [--raycasts N] [--json file]\n";
+		return 1;
+	}
+
+	std::vector<BenchmarkResult> results;
+	int raycastMismatches = 0;
+	for (BenchmarkScene scene : settings.scenes) {
+		for (int bodies : settings.bodyCounts) {
+			BenchmarkResult r = RunBenchmark(settings, scene, bodies);
+			results.emplace_back(r);
+
+			std::cerr << sceneNames[(int)scene] << " " << bodies << " bodies: "
+				<< r.frameTime * 1000.0 / settings.frames << "ms per frame, "
+				<< r.broadphasePairs / settings.frames << " pairs, "
+				<< r.allocations / (double)settings.frames << " allocations per frame\n";
+
+			if (settings.raycasts > 0) {
+				std::cerr << "\t" << settings.raycasts << " rays: "
+					<< r.singleRayTime * 1000000.0 / settings.raycasts << "us each one at a time, "
+					<< r.batchRayTime * 1000000.0 / settings.raycasts << "us batched, "
+					<< r.jobBatchRayTime * 1000000.0 / settings.raycasts << "us batched over "
+					<< settings.workers << " workers, " << r.raycastMismatches << " mismatches\n";
+				raycastMismatches += r.raycastMismatches;
+			}
+		}
+	}
+
+	std::string json = ToJson(settings, results);
+	if (settings.jsonFile.empty()) {
+		std::cout << json;
+	}
+	else {
+		std::ofstream file(settings.jsonFile);
+		if (!file) {
+			std::cerr << "Couldn't open " << settings.jsonFile << " for writing\n";
+			return 1;
+		}
+		file << json;
+	}
+	if (raycastMismatches > 0) {
+		std::cerr << raycastMismatches << " batched rays didn't hit what they did when cast one at a time\n";
+		return 1;
+	}
+	return 0;
+}
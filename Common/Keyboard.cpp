@@ -1,4 +1,5 @@
 #include "Keyboard.h"
+#include <cstring>
 #include <string>
 
 using namespace NCL;
@@ -9,6 +9,7 @@ https://research.ncl.ac.uk/game/
 #pragma once
 #include "Vector2.h"
 #include <assert.h>
+#include <cstring>
 namespace NCL {
 	namespace Maths {
 		class Matrix2 {
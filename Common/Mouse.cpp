@@ -1,4 +1,5 @@
 #include "Mouse.h"
+#include <cstring>
 #include <string>
 
 using namespace NCL;
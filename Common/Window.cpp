@@ -41,6 +41,7 @@ Window* Window::CreateGameWindow(std::string title, int sizeX, int sizeY, bool f
 #ifdef __ORBIS__
 	return new PS4::PS4Window(title, sizeX, sizeY, fullScreen, offsetX, offsetY);
 #endif
+	return nullptr;
 }
 
 void	Window::SetRenderer(RendererBase* r) {